@@ -1,5 +1,36 @@
 #include "Actor.h"
 #include "StudentWorld.h"
+#include "AllocationTracker.h"
+#include "LevelArena.h"
+#include "RenderBuffer.h"
+#include <mutex>
+
+// Guards the framework's display lists
+static mutex displayListMutex;
+
+/*---------------------*/
+/*---DisplayListLock---*/
+/*---------------------*/
+
+// Constructor, taken before the GraphObject part of an actor adds itself to the display lists
+DisplayListLock::DisplayListLock() {
+    lock();
+}
+
+// Destructor, runs after the GraphObject part of an actor has removed itself
+DisplayListLock::~DisplayListLock() {
+    unlock();
+}
+
+// Lock the display lists
+void DisplayListLock::lock() {
+    displayListMutex.lock();
+}
+
+// Unlock the display lists
+void DisplayListLock::unlock() {
+    displayListMutex.unlock();
+}
 
 /*---------------------*/
 /*--------Actor--------*/
@@ -7,8 +38,57 @@
 
 // Constructor
 Actor::Actor(StudentWorld* studentWorld, int objectType, int imageID, double startX, double startY, Direction dir, int depth, double size)
-    : m_studentWorld(studentWorld), m_objectType(objectType), GraphObject(imageID, startX, startY, dir, depth, size), m_active(true)
-{}
+    : m_studentWorld(studentWorld), m_flags(objectType | FLAG_ACTIVE), GraphObject(imageID, startX, startY, dir, depth, size), m_id(-1), m_record(-1)
+{
+    // The GraphObject is in the display lists by now
+    unlock();
+}
+
+// Destructor
+Actor::~Actor() {
+    // Held until DisplayListLock's destructor, after the GraphObject has left the display lists
+    lock();
+}
+
+// Allocate an actor
+void* Actor::operator new(size_t size) {
+    return allocateInCategory(ALLOC_ACTORS, size);
+}
+
+// Free an actor
+void Actor::operator delete(void* pointer) {
+    freeInCategory(pointer);
+}
+
+// Allocate an actor in the arena of a level
+void* Actor::operator new(size_t size, LevelArena& arena) {
+    return arena.allocate(size);
+}
+
+// Free an arena actor whose constructor threw, the arena takes its memory back with the rest of the level
+void Actor::operator delete(void*, LevelArena&) {
+}
+
+// Destroy an actor, freeing its memory unless it belongs to an arena
+void Actor::destroy(Actor* actor) {
+    if (actor->m_flags & FLAG_ARENA)
+        actor->~Actor();
+    else
+        delete actor;
+}
+
+// Mark the actor as allocated in an arena
+void Actor::setInArena() {
+    m_flags |= FLAG_ARENA;
+}
+
+// Copy the state every actor has from the actor this one is a clone of
+void Actor::copyStateFrom(const Actor& other) {
+    setDirection(other.getDirection());
+    // Clones are allocated on their own, whatever the original was
+    m_flags = (other.m_flags & ~FLAG_ARENA) | (m_flags & FLAG_ARENA);
+    m_id = other.m_id;
+}
 
 // Return the student world the actor lives in
 StudentWorld* Actor::studentWorld() const {
@@ -17,17 +97,64 @@ StudentWorld* Actor::studentWorld() const {
 
 // Return the actor's most specific type
 int Actor::objectType() const {
-    return m_objectType;
+    return m_flags & FLAG_TYPE_MASK;
+}
+
+// Return the actor's packed type and flags
+unsigned int Actor::flags() const {
+    return m_flags;
+}
+
+// Return the actor's id, which the world hands out in the order actors join the level
+int Actor::id() const {
+    return m_id;
+}
+
+// Set the actor's id
+void Actor::setId(int id) {
+    m_id = id;
+}
+
+// Return the index of the actor's record in the world, -1 if the actor is not part of the world
+int Actor::record() const {
+    return m_record;
+}
+
+// Set the index of the actor's record in the world
+void Actor::setRecord(int record) {
+    m_record = record;
 }
 
 // Return whether or not the actor is active
 bool Actor::isActive() const {
-    return m_active;
+    return (m_flags & FLAG_ACTIVE) != 0;
 }
 
 // Deactivate the actor
 void Actor::deactivate() {
-    m_active = false;
+    m_flags &= ~FLAG_ACTIVE;
+    if (m_record >= 0)
+        m_studentWorld->updateRecord(this);
+}
+
+// Move the actor to a new position
+void Actor::moveTo(double x, double y) {
+    GraphObject::moveTo(x, y);
+    if (m_record >= 0)
+        m_studentWorld->updateRecord(this);
+}
+
+// Move the actor a number of units in a given direction
+void Actor::moveAngle(Direction angle, int units) {
+    double x;
+    double y;
+    getPositionInThisDirection(angle, units, x, y);
+    moveTo(x, y);
+}
+
+// Move the actor a number of units in the direction it is facing
+void Actor::moveForward(int units) {
+    moveAngle(getDirection(), units);
 }
 
 // The actor takes damage and is deactivated
@@ -35,6 +162,71 @@ void Actor::takeDamage(int amount) {
     deactivate();
 }
 
+// Record the state shared by every actor, subclasses add their own hit points and counters
+void Actor::getState(ActorState& state) const {
+    state.id = m_id;
+    state.objectType = objectType();
+    state.x = getX();
+    state.y = getY();
+    state.direction = getDirection();
+    state.active = isActive();
+    state.hitPoints = 0;
+    for (int i = 0; i < ActorState::NUMBER_OF_COUNTERS; i++)
+        state.counters[i] = 0;
+}
+
+// Return the number of ids the actor takes, one for every actor but those that stand in for several
+int Actor::idCount() const {
+    return 1;
+}
+
+// Record the state of the actor, or of each actor it stands in for
+int Actor::getStates(ActorState* states) const {
+    getState(states[0]);
+    return 1;
+}
+
+// Record what the display needs of the actor's sprite, or of each sprite of the actors it stands in for
+int Actor::getSprites(RenderSprite* sprites) const {
+    RenderSprite& sprite = sprites[0];
+    sprite.imageID = getID();
+    sprite.x = (float) getX();
+    sprite.y = (float) getY();
+    sprite.direction = (short) getDirection();
+    sprite.depth = (short) getDepth();
+    sprite.size = (float) getSize();
+    return 1;
+}
+
+// Return the name of one of the type specific counters of a snapshot
+const char* ActorState::counterName(int index) const {
+    static const char* const pitCounters[] = { "regularSalmonella", "aggressiveSalmonella", "eColi" };
+    static const char* const projectileCounters[] = { "distanceTraveled", "-", "-" };
+    static const char* const itemCounters[] = { "lifeTime", "-", "-" };
+    static const char* const socratesCounters[] = { "sprays", "ftCharges", "-" };
+    static const char* const bacteriaCounters[] = { "movementPlan", "totalFood", "-" };
+    switch (objectType) {
+        case ID_PIT:
+            return pitCounters[index];
+        case ID_SPRAY:
+        case ID_FLAME:
+            return projectileCounters[index];
+        case ID_HEALTH_GOODIE:
+        case ID_FLAME_GOODIE:
+        case ID_LIFE_GOODIE:
+        case ID_FUNGI:
+            return itemCounters[index];
+        case ID_SOCRATES:
+            return socratesCounters[index];
+        case ID_REGULAR_SALMONELLA:
+        case ID_AGGRESSIVE_SALMONELLA:
+        case ID_ECOLI:
+            return bacteriaCounters[index];
+        default:
+            return "-";
+    }
+}
+
 /*---------------------*/
 /*--------Dirt---------*/
 /*---------------------*/
@@ -44,6 +236,13 @@ Dirt::Dirt(StudentWorld* studentWorld, double startX, double startY)
     : Actor(studentWorld, ID_DIRT, IID_DIRT, startX, startY, 0, 1)
 {}
 
+// Clone the dirt for another world
+Actor* Dirt::clone(StudentWorld* studentWorld) const {
+    Dirt* copy = new Dirt(studentWorld, getX(), getY());
+    copy->copyStateFrom(*this);
+    return copy;
+}
+
 // Dirt does nothing
 void Dirt::doSomething() {
     return;
@@ -58,6 +257,13 @@ Food::Food (StudentWorld* studentWorld, double startX, double startY)
     : Actor(studentWorld, ID_FOOD, IID_FOOD, startX, startY, 90, 1)
 {}
 
+// Clone the food for another world
+Actor* Food::clone(StudentWorld* studentWorld) const {
+    Food* copy = new Food(studentWorld, getX(), getY());
+    copy->copyStateFrom(*this);
+    return copy;
+}
+
 // Food does nothing on its own
 void Food::doSomething() {
     return;
@@ -68,9 +274,19 @@ void Food::doSomething() {
 /*---------------------*/
 
 Pit::Pit(StudentWorld* studentWorld, double startX, double startY)
-    : Actor(studentWorld, ID_PIT, IID_PIT, startX, startY, 0, 1), m_numberOfRegularSalmonella(5), m_numberOfAggressiveSalmonella(3), m_numberOfEColi(2)
+    : Actor(studentWorld, ID_PIT, IID_PIT, startX, startY, 0, 1), m_numberOfRegularSalmonella(studentWorld->worldConfig().pitRegularSalmonella), m_numberOfAggressiveSalmonella(studentWorld->worldConfig().pitAggressiveSalmonella), m_numberOfEColi(studentWorld->worldConfig().pitEColi)
 {}
 
+// Clone the pit for another world, along with the bacteria it has left
+Actor* Pit::clone(StudentWorld* studentWorld) const {
+    Pit* copy = new Pit(studentWorld, getX(), getY());
+    copy->copyStateFrom(*this);
+    copy->m_numberOfRegularSalmonella = m_numberOfRegularSalmonella;
+    copy->m_numberOfAggressiveSalmonella = m_numberOfAggressiveSalmonella;
+    copy->m_numberOfEColi = m_numberOfEColi;
+    return copy;
+}
+
 bool Pit::isEmpty() const {
     if (m_numberOfRegularSalmonella == 0 && m_numberOfAggressiveSalmonella == 0 && m_numberOfEColi == 0)
         return true;
@@ -86,7 +302,7 @@ void Pit::doSomething() {
         return;
     }
     
-    if (randInt(1, 50) == 1) {
+    if (studentWorld()->randInt(1, 50) == 1) {
         int RegSal = 0;
         int AggSal = 0;
         int eColi = 0;
@@ -105,7 +321,7 @@ void Pit::doSomething() {
             eColi = count;
         }
         
-        int bacteria = randInt(1, count);
+        int bacteria = studentWorld()->randInt(1, count);
         
         Bacteria* newBacteria = nullptr;
         
@@ -129,30 +345,56 @@ void Pit::doSomething() {
     }
 }
 
+// Record how many bacteria of each type are left in the pit
+void Pit::getState(ActorState& state) const {
+    Actor::getState(state);
+    state.counters[0] = m_numberOfRegularSalmonella;
+    state.counters[1] = m_numberOfAggressiveSalmonella;
+    state.counters[2] = m_numberOfEColi;
+}
+
 /*---------------------*/
 /*-----Projectile------*/
 /*---------------------*/
 
+// Object types that projectiles damage without moving, dirt
+const unsigned int PROJECTILE_STATIC_TARGETS = MASK_DAMAGEABLE & MASK_STATIC;
+
 // Constructor
 Projectile::Projectile(StudentWorld* studentWorld, int objectType, int imageID, double startX, double startY, Direction dir, int maximumTravelDistance, int damage)
-    : Actor(studentWorld, objectType, imageID, startX, startY, dir, 1), m_distanceTraveled(0), m_maximumTravelDistance(maximumTravelDistance), m_damage(damage)
+    : Actor(studentWorld, objectType, imageID, startX, startY, dir, 1), m_distanceTraveled(0), m_maximumTravelDistance(maximumTravelDistance), m_damage(damage), m_dirtDistance(0), m_dirtVersion(-1)
 {}
 
+// Copy how far the projectile this one is a clone of has traveled
+void Projectile::copyStateFrom(const Projectile& other) {
+    Actor::copyStateFrom(other);
+    m_distanceTraveled = other.m_distanceTraveled;
+}
+
 // Projectile does something during every tick
 void Projectile::doSomething() {
     // Do nothing if it is not active
     if (!isActive())
         return;
     
+    // Dirt never moves, so how far the projectile can travel before it could touch any is worked out along its straight
+    // path once, and again only if dirt is added. Until then only the targets that move are checked
+    if (m_dirtVersion != studentWorld()->staticVersion()) {
+        int steps = (m_maximumTravelDistance - m_distanceTraveled + SPRITE_WIDTH - 1) / SPRITE_WIDTH;
+        int step = studentWorld()->firstStaticStep(getX(), getY(), getDirection(), SPRITE_WIDTH, steps, PROJECTILE_STATIC_TARGETS, SPRITE_WIDTH);
+        m_dirtDistance = m_distanceTraveled + step * SPRITE_WIDTH;
+        m_dirtVersion = studentWorld()->staticVersion();
+    }
+    unsigned int targets = MASK_DAMAGEABLE;
+    if (m_distanceTraveled < m_dirtDistance)
+        targets &= ~PROJECTILE_STATIC_TARGETS;
+    
     // Check to see if the projectile overlaps with any damageable object and apply damage if necessary
-    list<Actor*> overlaps;
-    studentWorld()->getOverlap(this, overlaps, SPRITE_WIDTH);
-    for (list<Actor*>::iterator p = overlaps.begin(); p != overlaps.end(); p++) {
-        if (damageableObject((*p)->objectType())) {
-            (*p)->takeDamage(m_damage);
-            deactivate();
-            return;
-        }
+    Actor* target = studentWorld()->firstContact(this, targets, SPRITE_WIDTH);
+    if (target != nullptr) {
+        target->takeDamage(m_damage);
+        deactivate();
+        return;
     }
     
     // The projectile continues to move forward
@@ -164,24 +406,10 @@ void Projectile::doSomething() {
         deactivate();
 }
 
-// Checks whether or not the projectile damages a particular object type
-bool Projectile::damageableObject(int objectType) const {
-    bool toReturn = false;
-    switch (objectType) {
-        case ID_REGULAR_SALMONELLA:
-        case ID_AGGRESSIVE_SALMONELLA:
-        case ID_ECOLI:
-        case ID_FUNGI:
-        case ID_HEALTH_GOODIE:
-        case ID_FLAME_GOODIE:
-        case ID_LIFE_GOODIE:
-        case ID_DIRT:
-            toReturn = true;
-            break;
-        default:
-            break;
-    }
-    return toReturn;
+// Record how far the projectile has traveled
+void Projectile::getState(ActorState& state) const {
+    Actor::getState(state);
+    state.counters[0] = m_distanceTraveled;
 }
 
 /*---------------------*/
@@ -193,24 +421,169 @@ Spray::Spray(StudentWorld* studentWorld, double startX, double startY, Direction
     : Projectile(studentWorld, ID_SPRAY, IID_SPRAY, startX, startY, dir, 112, 2)
 {}
 
+// Clone the spray for another world
+Actor* Spray::clone(StudentWorld* studentWorld) const {
+    Spray* copy = new Spray(studentWorld, getX(), getY(), getDirection());
+    copy->copyStateFrom(*this);
+    return copy;
+}
+
 /*---------------------*/
 /*--------Flame--------*/
 /*---------------------*/
 
 // Constructor
 Flame::Flame(StudentWorld* studentWorld, double startX, double startY, Direction dir)
-    : Projectile(studentWorld, ID_FLAME, IID_FLAME, startX, startY, dir, 32, 5)
+    : Projectile(studentWorld, ID_FLAME, IID_FLAME, startX, startY, dir, FLAME_MAX_DISTANCE, FLAME_DAMAGE)
 {}
 
+// Clone the flame for another world
+Actor* Flame::clone(StudentWorld* studentWorld) const {
+    Flame* copy = new Flame(studentWorld, getX(), getY(), getDirection());
+    copy->copyStateFrom(*this);
+    return copy;
+}
+
+/*---------------------*/
+/*------FlameBurst-----*/
+/*---------------------*/
+
+// Find the point some units away from another in a direction, exactly as GraphObject::getPositionInThisDirection would
+static void pointInDirection(double x, double y, int direction, int units, double& pointX, double& pointY) {
+    static const double PI = 4 * atan(1.0);
+    pointX = x + units * cos(direction * 1.0 / 360 * 2 * PI);
+    pointY = y + units * sin(direction * 1.0 / 360 * 2 * PI);
+}
+
+// Constructor, the flames start where the player would have put each of them
+FlameBurst::FlameBurst(StudentWorld* studentWorld, double originX, double originY, Direction dir)
+    : Actor(studentWorld, ID_FLAME, IID_FLAME, originX, originY, dir, 1), m_distanceTraveled(0)
+{
+    for (int i = 0; i < FLAME_BURST_RAYS; i++) {
+        Ray& ray = m_rays[i];
+        ray.direction = dir + i * FLAME_BURST_SPREAD;
+        pointInDirection(originX, originY, ray.direction, 2*SPRITE_RADIUS, ray.x, ray.y);
+        ray.inPlay = true;
+        ray.dirtDistance = 0;
+        ray.dirtVersion = -1;
+    }
+}
+
+// Clone the burst for another world
+Actor* FlameBurst::clone(StudentWorld* studentWorld) const {
+    FlameBurst* copy = new FlameBurst(studentWorld, getX(), getY(), getDirection());
+    copy->copyStateFrom(*this);
+    for (int i = 0; i < FLAME_BURST_RAYS; i++)
+        copy->m_rays[i] = m_rays[i];
+    copy->m_distanceTraveled = m_distanceTraveled;
+    return copy;
+}
+
+// Every flame still in play does what Projectile::doSomething does for a single flame
+void FlameBurst::doSomething() {
+    // Do nothing if it is not active
+    if (!isActive())
+        return;
+    
+    // Each flame works out how far it can travel before it could touch dirt on its own
+    RingPoint points[FLAME_BURST_RAYS];
+    int rays[FLAME_BURST_RAYS];
+    int count = 0;
+    for (int i = 0; i < FLAME_BURST_RAYS; i++) {
+        Ray& ray = m_rays[i];
+        if (!ray.inPlay)
+            continue;
+        if (ray.dirtVersion != studentWorld()->staticVersion()) {
+            int steps = (FLAME_MAX_DISTANCE - m_distanceTraveled + SPRITE_WIDTH - 1) / SPRITE_WIDTH;
+            int step = studentWorld()->firstStaticStep(ray.x, ray.y, ray.direction, SPRITE_WIDTH, steps, PROJECTILE_STATIC_TARGETS, SPRITE_WIDTH);
+            ray.dirtDistance = m_distanceTraveled + step * SPRITE_WIDTH;
+            ray.dirtVersion = studentWorld()->staticVersion();
+        }
+        points[count].x = ray.x;
+        points[count].y = ray.y;
+        points[count].types = MASK_DAMAGEABLE;
+        if (m_distanceTraveled < ray.dirtDistance)
+            points[count].types &= ~PROJECTILE_STATIC_TARGETS;
+        rays[count++] = i;
+    }
+    
+    // Separate flames would act one after another, but what they hit neither moves nor leaves the level before the tick
+    // ends, so every flame's target is the same when they are all looked up at once
+    Actor* targets[FLAME_BURST_RAYS];
+    studentWorld()->ringContacts(getX(), getY(), points, count, SPRITE_WIDTH, targets);
+    bool inPlay = false;
+    for (int k = 0; k < count; k++) {
+        Ray& ray = m_rays[rays[k]];
+        if (targets[k] != nullptr) {
+            targets[k]->takeDamage(FLAME_DAMAGE);
+            ray.inPlay = false;
+        }
+        else {
+            pointInDirection(ray.x, ray.y, ray.direction, SPRITE_WIDTH, ray.x, ray.y);
+            inPlay = true;
+        }
+    }
+    m_distanceTraveled += SPRITE_WIDTH;
+    
+    // The burst is over once every flame has hit something or reached the flames' maximum distance
+    if (!inPlay || m_distanceTraveled >= FLAME_MAX_DISTANCE)
+        deactivate();
+}
+
+// Return one id for each flame
+int FlameBurst::idCount() const {
+    return FLAME_BURST_RAYS;
+}
+
+// Record the state each flame still in play would have on its own
+int FlameBurst::getStates(ActorState* states) const {
+    int count = 0;
+    for (int i = 0; i < FLAME_BURST_RAYS; i++) {
+        const Ray& ray = m_rays[i];
+        if (!ray.inPlay)
+            continue;
+        ActorState& state = states[count++];
+        Actor::getState(state);
+        state.id = id() + i;
+        state.x = ray.x;
+        state.y = ray.y;
+        state.direction = ray.direction;
+        state.counters[0] = m_distanceTraveled;
+    }
+    return count;
+}
+
+// Record the sprite each flame still in play would have on its own
+int FlameBurst::getSprites(RenderSprite* sprites) const {
+    int count = 0;
+    for (int i = 0; i < FLAME_BURST_RAYS; i++) {
+        const Ray& ray = m_rays[i];
+        if (!ray.inPlay)
+            continue;
+        RenderSprite& sprite = sprites[count++];
+        Actor::getSprites(&sprite);
+        sprite.x = (float) ray.x;
+        sprite.y = (float) ray.y;
+        sprite.direction = (short) ray.direction;
+    }
+    return count;
+}
+
 /*---------------------*/
 /*---------Item--------*/
 /*---------------------*/
 
 // Constructor
-Item::Item(StudentWorld* studentWorld, int objectType, int imageID, double startX, double startY, int scoreChange, bool hasSound)
-    : Actor(studentWorld, objectType, imageID, startX, startY, 0, 1), m_lifeTime(max(randInt(0, 300 - 10 * (studentWorld->getLevel()) - 1), 50)), m_hasSound(hasSound), m_scoreChange(scoreChange)
+// A negative lifetime rolls a random one for the current level
+Item::Item(StudentWorld* studentWorld, int objectType, int imageID, double startX, double startY, int scoreChange, bool hasSound, int lifeTime)
+    : Actor(studentWorld, objectType, imageID, startX, startY, 0, 1), m_lifeTime(lifeTime >= 0 ? lifeTime : max(studentWorld->randInt(0, 300 - 10 * (studentWorld->getLevel()) - 1), 50)), m_hasSound(hasSound), m_scoreChange(scoreChange)
 {}
 
+// Return the number of ticks the item has left
+int Item::lifeTime() const {
+    return m_lifeTime;
+}
+
 // Item does something during every tick
 void Item::doSomething() {
     // Do nothing if it is not active
@@ -219,7 +592,7 @@ void Item::doSomething() {
     
     // Check to see if the item overlaps with the player
     // If necessary, item will update the game score, perform its unique player interaction, and play a sound indicating a goodie was obtained
-    if(studentWorld()->isOverlap(this, studentWorld()->player(), SPRITE_WIDTH)) {
+    if(studentWorld()->overlapsPlayer(this, SPRITE_WIDTH)) {
         studentWorld()->increaseScore(m_scoreChange);
         if (m_hasSound)
             studentWorld()->playSound(SOUND_GOT_GOODIE);
@@ -236,15 +609,33 @@ void Item::doSomething() {
         deactivate();
 }
 
+// Take ticks the item spent doing nothing off its lifetime at once
+void Item::age(int ticks) {
+    m_lifeTime -= ticks;
+}
+
+// Record the remaining lifetime of the item
+void Item::getState(ActorState& state) const {
+    Actor::getState(state);
+    state.counters[0] = m_lifeTime;
+}
+
 /*---------------------*/
 /*-----HealthGoodie----*/
 /*---------------------*/
 
 // Constructor
-HealthGoodie::HealthGoodie(StudentWorld* studentWorld, double startX, double startY)
-    : Item(studentWorld, ID_HEALTH_GOODIE, IID_RESTORE_HEALTH_GOODIE, startX, startY, 250, true)
+HealthGoodie::HealthGoodie(StudentWorld* studentWorld, double startX, double startY, int lifeTime)
+    : Item(studentWorld, ID_HEALTH_GOODIE, IID_RESTORE_HEALTH_GOODIE, startX, startY, 250, true, lifeTime)
 {}
 
+// Clone the health goodie for another world, passing on the remaining lifetime instead of rolling a new one
+Actor* HealthGoodie::clone(StudentWorld* studentWorld) const {
+    HealthGoodie* copy = new HealthGoodie(studentWorld, getX(), getY(), lifeTime());
+    copy->copyStateFrom(*this);
+    return copy;
+}
+
 // Health goodie increases player's hit points
 void HealthGoodie::playerInteraction() {
     studentWorld()->player()->gainHitPoints(100);
@@ -255,10 +646,17 @@ void HealthGoodie::playerInteraction() {
 /*---------------------*/
 
 // Constructor
-FTGoodie::FTGoodie(StudentWorld* studentWorld, double startX, double startY)
-    : Item(studentWorld, ID_FLAME_GOODIE, IID_FLAME_THROWER_GOODIE, startX, startY, 300, true)
+FTGoodie::FTGoodie(StudentWorld* studentWorld, double startX, double startY, int lifeTime)
+    : Item(studentWorld, ID_FLAME_GOODIE, IID_FLAME_THROWER_GOODIE, startX, startY, 300, true, lifeTime)
 {}
 
+// Clone the flame goodie for another world, passing on the remaining lifetime instead of rolling a new one
+Actor* FTGoodie::clone(StudentWorld* studentWorld) const {
+    FTGoodie* copy = new FTGoodie(studentWorld, getX(), getY(), lifeTime());
+    copy->copyStateFrom(*this);
+    return copy;
+}
+
 // Flame goodies reset player's flame charges to 5
 void FTGoodie::playerInteraction() {
     studentWorld()->player()->increaseFTCharges(5);
@@ -269,10 +667,17 @@ void FTGoodie::playerInteraction() {
 /*---------------------*/
 
 // Constructor
-LifeGoodie::LifeGoodie(StudentWorld* studentWorld, double startX, double startY)
-    : Item(studentWorld, ID_LIFE_GOODIE, IID_EXTRA_LIFE_GOODIE, startX, startY, 500, true)
+LifeGoodie::LifeGoodie(StudentWorld* studentWorld, double startX, double startY, int lifeTime)
+    : Item(studentWorld, ID_LIFE_GOODIE, IID_EXTRA_LIFE_GOODIE, startX, startY, 500, true, lifeTime)
 {}
 
+// Clone the life goodie for another world, passing on the remaining lifetime instead of rolling a new one
+Actor* LifeGoodie::clone(StudentWorld* studentWorld) const {
+    LifeGoodie* copy = new LifeGoodie(studentWorld, getX(), getY(), lifeTime());
+    copy->copyStateFrom(*this);
+    return copy;
+}
+
 // Life goodies give the player an extra life
 void LifeGoodie::playerInteraction() {
     studentWorld()->incLives();
@@ -283,10 +688,17 @@ void LifeGoodie::playerInteraction() {
 /*---------------------*/
 
 // Constructor
-Fungus::Fungus(StudentWorld* studentWorld, double startX, double startY)
-    : Item(studentWorld, ID_FUNGI, IID_FUNGUS, startX, startY, -50, false)
+Fungus::Fungus(StudentWorld* studentWorld, double startX, double startY, int lifeTime)
+    : Item(studentWorld, ID_FUNGI, IID_FUNGUS, startX, startY, -50, false, lifeTime)
 {}
 
+// Clone the fungus for another world, passing on the remaining lifetime instead of rolling a new one
+Actor* Fungus::clone(StudentWorld* studentWorld) const {
+    Fungus* copy = new Fungus(studentWorld, getX(), getY(), lifeTime());
+    copy->copyStateFrom(*this);
+    return copy;
+}
+
 // Fungus damages the player by 20 hit points
 void Fungus::playerInteraction() {
     studentWorld()->player()->takeDamage(20);
@@ -301,6 +713,12 @@ Agent::Agent(StudentWorld* studentWorld, int objectType, int imageID, double sta
     : Actor(studentWorld, objectType, imageID, startX, startY, dir), m_hitPoints(hitPoints)
 {}
 
+// Copy the hit points of the agent this one is a clone of
+void Agent::copyStateFrom(const Agent& other) {
+    Actor::copyStateFrom(other);
+    m_hitPoints = other.m_hitPoints;
+}
+
 // Returns number of hit points the agent has
 int Agent::hitPoints() const {
     return m_hitPoints;
@@ -314,6 +732,12 @@ void Agent::gainHitPoints(int amount) {
         m_hitPoints += amount;
 }
 
+// Record the agent's hit points
+void Agent::getState(ActorState& state) const {
+    Actor::getState(state);
+    state.hitPoints = m_hitPoints;
+}
+
 // Damages the agent by a given amount of hitpoints
 void Agent::takeDamage(int amount) {
     m_hitPoints -= amount;
@@ -334,9 +758,19 @@ void Agent::takeDamage(int amount) {
 
 // Constructor
 Socrates::Socrates(StudentWorld* studentWorld, double startX, double startY)
-    : m_sprays(20), m_FTcharges(5), Agent(studentWorld, ID_SOCRATES, IID_PLAYER, 0, VIEW_HEIGHT/2, 0, 100)
+    : m_sprays(20), m_FTcharges(5), Agent(studentWorld, ID_SOCRATES, IID_PLAYER, 0, studentWorld->dishCenterY(), 0, 100)
 {}
 
+// Clone the player for another world, the constructor always starts it at the left of the dish
+Actor* Socrates::clone(StudentWorld* studentWorld) const {
+    Socrates* copy = new Socrates(studentWorld, getX(), getY());
+    copy->copyStateFrom(*this);
+    copy->moveTo(getX(), getY());
+    copy->m_sprays = m_sprays;
+    copy->m_FTcharges = m_FTcharges;
+    return copy;
+}
+
 // Socrates does something during every tick
 void Socrates::doSomething() {
     // If Socrates is not active, do nothing
@@ -351,19 +785,22 @@ void Socrates::doSomething() {
         double angle = 0;
         double x = getX();
         double y = getY();
+        double centerX = studentWorld()->dishCenterX();
+        double centerY = studentWorld()->dishCenterY();
+        double radius = studentWorld()->dishRadius();
         
-        if (x == 0)
+        if (x == centerX - radius)
             angle = M_PI;
-        else if (x == VIEW_WIDTH)
+        else if (x == centerX + radius)
             angle = 0;
-        else if (y == 0)
+        else if (y == centerY - radius)
             angle = 3 * M_PI / 2;
-        else if (y == VIEW_HEIGHT)
+        else if (y == centerY + radius)
             angle = M_PI / 2;
-        else if (y > VIEW_HEIGHT/2)
-            angle = acos( (x - (VIEW_WIDTH/2)) / VIEW_RADIUS);
-        else if (y < VIEW_HEIGHT/2)
-            angle = -1 * acos( (x - (VIEW_WIDTH/2)) / VIEW_RADIUS);
+        else if (y > centerY)
+            angle = acos( (x - centerX) / radius);
+        else if (y < centerY)
+            angle = -1 * acos( (x - centerX) / radius);
         
         double newX;
         double newY;
@@ -371,16 +808,16 @@ void Socrates::doSomething() {
         {
             // Move counterclockwise if user input is left key
             case KEY_PRESS_LEFT:
-                newX = cos(angle + 5 * M_PI / 180) * VIEW_RADIUS + VIEW_HEIGHT/2;
-                newY = sin(angle + 5 * M_PI / 180) * VIEW_RADIUS + VIEW_WIDTH/2;
+                newX = cos(angle + 5 * M_PI / 180) * radius + centerX;
+                newY = sin(angle + 5 * M_PI / 180) * radius + centerY;
                 moveTo(newX, newY);
                 setDirection((angle * 180) / M_PI + 185);
                 break;
                 
             // Move clockwise if user input is right key
             case KEY_PRESS_RIGHT:
-                newX = cos(angle - 5 * M_PI / 180) * VIEW_RADIUS + VIEW_HEIGHT/2;
-                newY = sin(angle - 5 * M_PI / 180) * VIEW_RADIUS + VIEW_WIDTH/2;
+                newX = cos(angle - 5 * M_PI / 180) * radius + centerX;
+                newY = sin(angle - 5 * M_PI / 180) * radius + centerY;
                 moveTo(newX, newY);
                 setDirection((angle * 180) / M_PI + 175);
                 break;
@@ -400,11 +837,16 @@ void Socrates::doSomething() {
             // Try to fire flame projectiles if user input is enter key
             case KEY_PRESS_ENTER:
                 if (m_FTcharges >= 1) {
-                    // Flame projectiles are fired outward from player in all directions
-                    for (int i = 0; i < 16; i++) {
-                        getPositionInThisDirection(getDirection() + (i * 22), 2*SPRITE_RADIUS, newX, newY);
-                        Flame* newFlame = new Flame(studentWorld(), newX, newY, getDirection() + (i * 22));
-                        studentWorld()->addActor(newFlame);
+                    // Flame projectiles are fired outward from player in all directions. The display needs a sprite
+                    // for each of them, headless worlds of the optimized engine fire them as a single burst
+                    if (studentWorld()->isHeadless() && studentWorld()->engine() == ENGINE_OPTIMIZED)
+                        studentWorld()->addActor(new FlameBurst(studentWorld(), getX(), getY(), getDirection()));
+                    else {
+                        for (int i = 0; i < FLAME_BURST_RAYS; i++) {
+                            getPositionInThisDirection(getDirection() + (i * FLAME_BURST_SPREAD), 2*SPRITE_RADIUS, newX, newY);
+                            Flame* newFlame = new Flame(studentWorld(), newX, newY, getDirection() + (i * FLAME_BURST_SPREAD));
+                            studentWorld()->addActor(newFlame);
+                        }
                     }
                     m_FTcharges--;
                     studentWorld()->playSound(SOUND_PLAYER_FIRE);
@@ -440,6 +882,13 @@ int Socrates::ftCharges() const {
     return m_FTcharges;
 }
 
+// Record the player's sprays and flame charges
+void Socrates::getState(ActorState& state) const {
+    Agent::getState(state);
+    state.counters[0] = m_sprays;
+    state.counters[1] = m_FTcharges;
+}
+
 // Increase the flame charges
 void Socrates::increaseFTCharges(int amount) {
     m_FTcharges += amount;
@@ -451,9 +900,21 @@ void Socrates::increaseFTCharges(int amount) {
 
 // Constructor
 Bacteria::Bacteria(StudentWorld* studentWorld, int objectType, int imageID, double startX, double startY, int hitPoints, int damage, bool isAgressiveSalmonella, bool isSalmonella)
-    : Agent(studentWorld, objectType, imageID, startX, startY, 90, hitPoints), m_movementPlanDistance(0), m_damage(damage), m_totalFood(0), m_isAggressive(isAgressiveSalmonella), m_isSalmonella(isSalmonella)
+    : Agent(studentWorld, objectType, imageID, startX, startY, 90, hitPoints), m_sleepVersion(-1), m_sleepScale(1), m_blockedPlans(0), m_movementPlanDistance(0), m_damage(damage), m_totalFood(0), m_isAggressive(isAgressiveSalmonella), m_isSalmonella(isSalmonella), m_stepScale(1), m_thinkPending(false)
 {}
 
+// Copy the plan, food, level of detail and sleep state of the bacterium this one is a clone of
+void Bacteria::copyStateFrom(const Bacteria& other) {
+    Agent::copyStateFrom(other);
+    m_sleepVersion = other.m_sleepVersion;
+    m_sleepScale = other.m_sleepScale;
+    m_blockedPlans = other.m_blockedPlans;
+    m_movementPlanDistance = other.m_movementPlanDistance;
+    m_totalFood = other.m_totalFood;
+    m_stepScale = other.m_stepScale;
+    m_thinkPending = other.m_thinkPending;
+}
+
 // Calculate the distance between two points
 double Bacteria::distance(double x1, double y1, double x2, double y2) const {
     double dx = x2 - x1;
@@ -471,9 +932,52 @@ int Bacteria::movementPlan() {
     return m_movementPlanDistance;
 }
 
-// Decrease movement plan
+// Decrease movement plan, a scaled step uses up as much of the plan as the steps it stands for
 void Bacteria::decreaseMovementPlan() {
-    m_movementPlanDistance--;
+    m_movementPlanDistance = max(m_movementPlanDistance - m_stepScale, 0);
+}
+
+// Return how many regular steps the current final action stands for
+int Bacteria::stepScale() const {
+    return m_stepScale;
+}
+
+// Check whether the bacterium is still asleep, waking it if its region changed or its steps got shorter since it fell
+// asleep. Ecoli head for the player, so they wake whenever the player moves too
+bool Bacteria::isAsleep() {
+    if (m_sleepVersion < 0)
+        return false;
+    if (m_stepScale >= m_sleepScale && studentWorld()->sleepVersion(getX(), getY(), !m_isSalmonella) == m_sleepVersion)
+        return true;
+    m_sleepVersion = -1;
+    return false;
+}
+
+// Sleep until the bacterium's region changes, if the world lets bacteria sleep. Its plan is to fail just the same with
+// steps of at least the given scale
+void Bacteria::fallAsleep(int minimumScale) {
+    m_sleepVersion = studentWorld()->sleepVersion(getX(), getY(), !m_isSalmonella);
+    m_sleepScale = minimumScale;
+}
+
+// Count a blocked plan, returns true every SALMONELLA_BOXED_CHECK of them in a row
+bool Bacteria::countBlockedPlan() {
+    if (++m_blockedPlans < SALMONELLA_BOXED_CHECK)
+        return false;
+    m_blockedPlans = 0;
+    return true;
+}
+
+// Start counting blocked plans over
+void Bacteria::clearBlockedPlans() {
+    m_blockedPlans = 0;
+}
+
+// Record the bacteria's movement plan and food count
+void Bacteria::getState(ActorState& state) const {
+    Agent::getState(state);
+    state.counters[0] = m_movementPlanDistance;
+    state.counters[1] = m_totalFood;
 }
 
 // An action performed by aggressive bacteria, returns whether or not the action occured
@@ -512,22 +1016,15 @@ bool Bacteria::aggressiveAction() {
         // Check for clear path of 3 units in direction of the player
         for (int i = 1; i <= 3; i++) {
             getPositionInThisDirection(angle, i, x, y);
-            Actor* tempSalmonella = new AggressiveSalmonella(studentWorld(), x, y);
             
             // Check to make sure bacteria would not overlap with dirt pile
-            list<Actor*> overlapsInDirection;
-            studentWorld()->getOverlap(tempSalmonella, overlapsInDirection, SPRITE_WIDTH/2);
-            for (list<Actor*>::iterator p = overlapsInDirection.begin(); p != overlapsInDirection.end(); p++) {
-                if ((*p)->objectType() == ID_DIRT)
-                    freeMovement = false;
-            }
+            if (studentWorld()->isDirtAt(x, y, SPRITE_WIDTH/2))
+                freeMovement = false;
             
             // Check to make sure bacteria would not exit the petri dish
-            if (distance(x, y, VIEW_WIDTH/2, VIEW_HEIGHT/2) >= VIEW_RADIUS)
+            if (distance(x, y, studentWorld()->dishCenterX(), studentWorld()->dishCenterY()) >= studentWorld()->dishRadius())
                 freeMovement = false;
             
-            delete tempSalmonella;
-            
             if (!freeMovement)
                 break;
         }
@@ -553,20 +1050,12 @@ void Bacteria::doSomething() {
     if (m_isAggressive)
         returnEarly = aggressiveAction();
     
-    // Check to see if the bacteria is currently overlapping with any food objects
-    bool overlapsFood = false;
-    Actor* food = nullptr;
-    list<Actor*> overlaps;
-    studentWorld()->getOverlap(this, overlaps, SPRITE_WIDTH);
-    for (list<Actor*>::iterator p = overlaps.begin(); p != overlaps.end(); p++) {
-        if ((*p)->objectType() == ID_FOOD) {
-            overlapsFood = true;
-            food = (*p);
-        }
-    }
+    // Check to see if the bacteria is currently overlapping with any food objects, the last one it overlaps is eaten
+    Actor* food = studentWorld()->lastContact(this, MASK_EDIBLE, SPRITE_WIDTH);
+    bool overlapsFood = (food != nullptr);
     
     // Check to see if the bacteria is currently overlapping with the player and damage the player if necessary
-    if (studentWorld()->isOverlap(this, studentWorld()->player(), SPRITE_WIDTH)) {
+    if (studentWorld()->overlapsPlayer(this, SPRITE_WIDTH)) {
         studentWorld()->player()->takeDamage(m_damage);
     }
     // Check the bacteria's current food count
@@ -575,15 +1064,17 @@ void Bacteria::doSomething() {
         // If the found count is at least three, spawn a new bacteria object of the same type
         double newX = getX();
         double newY = getY();
+        double centerX = studentWorld()->dishCenterX();
+        double centerY = studentWorld()->dishCenterY();
         
-        if (newX < VIEW_WIDTH/2)
+        if (newX < centerX)
             newX += SPRITE_WIDTH/2;
-        else if (newX > VIEW_WIDTH/2)
+        else if (newX > centerX)
             newX -= SPRITE_WIDTH/2;
         
-        if (newY < VIEW_HEIGHT/2)
+        if (newY < centerY)
             newY += SPRITE_WIDTH/2;
-        else if (newY > VIEW_HEIGHT/2)
+        else if (newY > centerY)
             newY -= SPRITE_WIDTH/2;
         
         if (m_isAggressive)
@@ -603,12 +1094,19 @@ void Bacteria::doSomething() {
         food->deactivate();
     }
     
-    // If the earlier aggressive action was successful, return now
-    if (returnEarly)
+    // If the earlier aggressive action was successful, return now. It may have moved the bacteria, which wakes it
+    if (returnEarly) {
+        m_sleepVersion = -1;
         return;
+    }
     
-    // Perform the bacteria's final action
+    // Perform the bacteria's final action, far away bacteria may think less often and take bigger steps
+    int scale = studentWorld()->aiStepScale(this, m_thinkPending);
+    if (scale == 0)
+        return;
+    m_stepScale = scale;
     finalAction();
+    m_stepScale = 1;
 }
 
 /*---------------------*/
@@ -638,65 +1136,56 @@ void Salmonella::finalAction() {
         
         decreaseMovementPlan();
         
+        // A salmonella boxed in on every side is blocked whichever way it heads, so it only picks a new direction
+        if (isAsleep()) {
+            setDirection(studentWorld()->randInt(0, 359));
+            resetMovementPlan();
+            return;
+        }
+        
         bool movementFree = true;
         double x = 0;
         double y = 0;
         
-        // Check if path of 3 units in current direction is valid
-        for (int i = 1; i <= 3; i++) {
+        // Check if path of 3 units (times the step scale) in current direction is valid
+        for (int i = 1; i <= 3 * stepScale(); i++) {
             getPositionInThisDirection(getDirection(), i, x, y);
-            Actor* tempSalmonella = new RegularSalmonella(studentWorld(), x, y);
             
             // Check to see if the path would overlap with any dirt piles
-            list<Actor*> overlapsMovement;
-            studentWorld()->getOverlap(tempSalmonella, overlapsMovement, SPRITE_WIDTH/2);
-            for (list<Actor*>::iterator p = overlapsMovement.begin(); p != overlapsMovement.end(); p++) {
-                if ((*p)->objectType() == ID_DIRT) {
-                    movementFree = false;
-                    break;
-                }
-            }
+            if (studentWorld()->isDirtAt(x, y, SPRITE_WIDTH/2))
+                movementFree = false;
 
             // Check to se if the path would take the salmonella outside the petri dish
-            double distanceFromCenter = distance(x, y, VIEW_WIDTH/2, VIEW_HEIGHT/2);
-            if (distanceFromCenter >= VIEW_RADIUS)
+            double distanceFromCenter = distance(x, y, studentWorld()->dishCenterX(), studentWorld()->dishCenterY());
+            if (distanceFromCenter >= studentWorld()->dishRadius())
                 movementFree = false;
             
-            delete tempSalmonella;
-            
             if (!movementFree)
                 break;
         }
         
-        // Move 3 units in current direction if path is valid
-        getPositionInThisDirection(getDirection(), 3, x, y);
+        // Move 3 units (times the step scale) in current direction if path is valid
+        getPositionInThisDirection(getDirection(), 3 * stepScale(), x, y);
         if (movementFree) {
             moveTo(x, y);
+            clearBlockedPlans();
         }
-        // Otherwise, randomize the salmonella's direction
+        // Otherwise, randomize the salmonella's direction, and sleep if it turns out to be boxed in
         else {
-            setDirection(randInt(0, 359));
+            setDirection(studentWorld()->randInt(0, 359));
             resetMovementPlan();
+            if (countBlockedPlan() && isBoxedIn())
+                fallAsleep(1);
         }
         return;
     }
     
     // Find any nearby food objects
-    Actor* closestFood = nullptr;
-    double smallestDistance = VIEW_RADIUS*2;
-    list<Actor*> allActors;
-    studentWorld()->getOverlap(this, allActors, VIEW_RADIUS*2);
-    for (list<Actor*>::iterator p = allActors.begin(); p != allActors.end(); p++) {
-        double dis = distance(getX(), getY(), (*p)->getX(), (*p)->getY());
-        if ((*p)->objectType() == ID_FOOD && dis < 128 && dis < smallestDistance) {
-            closestFood = (*p);
-            smallestDistance = dis;
-        }
-    }
+    Actor* closestFood = studentWorld()->nearestActor(this, ID_FOOD, 128);
     
     // If there is no nearby food object found, randomize the salmonella's direction
     if (closestFood == nullptr) {
-        setDirection(randInt(0, 359));
+        setDirection(studentWorld()->randInt(0, 359));
         resetMovementPlan();
         return;
     }
@@ -723,45 +1212,61 @@ void Salmonella::finalAction() {
     else if (dy < 0)
         angle = ( atan(dy/dx) * 180 / M_PI ) + 180;
     
-    // Make sure that path of 3 units in direction of food is valid
+    // Make sure that path of 3 units (times the step scale) in direction of food is valid
     double x;
     double y;
     bool freeMovement = true;
-    for (int i = 1; i <= 3; i++) {
+    for (int i = 1; i <= 3 * stepScale(); i++) {
         getPositionInThisDirection(angle, i, x, y);
-        Actor* tempSalmonella = new RegularSalmonella(studentWorld(), x, y);
         
         // Check to see if the path would overlap with any dirt piles
-        list<Actor*> overlapsInDirection;
-        studentWorld()->getOverlap(tempSalmonella, overlapsInDirection, SPRITE_WIDTH/2);
-        for (list<Actor*>::iterator p = overlapsInDirection.begin(); p != overlapsInDirection.end(); p++) {
-            if ((*p)->objectType() == ID_DIRT)
-                freeMovement = false;
-        }
+        if (studentWorld()->isDirtAt(x, y, SPRITE_WIDTH/2))
+            freeMovement = false;
         
         // Check to see if the path would make the salmonella exit the petri dish
-        double distanceFromCenter = distance(x, y, VIEW_WIDTH/2, VIEW_HEIGHT/2);
-        if (distanceFromCenter >= VIEW_RADIUS)
+        double distanceFromCenter = distance(x, y, studentWorld()->dishCenterX(), studentWorld()->dishCenterY());
+        if (distanceFromCenter >= studentWorld()->dishRadius())
             freeMovement = false;
         
-        delete tempSalmonella;
-        
         if (!freeMovement)
             break;
     }
     
     // If the path is valid, make the movement
     if (freeMovement) {
-        moveAngle(angle, 3);
+        moveAngle(angle, 3 * stepScale());
         setDirection(angle);
+        clearBlockedPlans();
     }
-    // If the path is not valid, randomize the salmonella's direction
+    // If the path is not valid, randomize the salmonella's direction, and sleep if it turns out to be boxed in
     else {
-        setDirection(randInt(0, 359));
+        setDirection(studentWorld()->randInt(0, 359));
         resetMovementPlan();
+        if (countBlockedPlan() && isBoxedIn())
+            fallAsleep(1);
     }
 }
 
+// Check whether a salmonella is blocked within 3 units in every direction it can pick, so that it can never move again
+// until some dirt near it goes. The directions are tried spread out, so one that is free tends to be found early
+bool Salmonella::isBoxedIn() {
+    if (3 + SPRITE_WIDTH/2 > BACTERIA_SLEEP_REACH || studentWorld()->sleepVersion(getX(), getY(), false) < 0)
+        return false;
+    for (int k = 0; k < 360; k++) {
+        int direction = k * 97 % 360;
+        bool blocked = false;
+        double x;
+        double y;
+        for (int i = 1; i <= 3 && !blocked; i++) {
+            getPositionInThisDirection(direction, i, x, y);
+            blocked = studentWorld()->isDirtAt(x, y, SPRITE_WIDTH/2) || distance(x, y, studentWorld()->dishCenterX(), studentWorld()->dishCenterY()) >= studentWorld()->dishRadius();
+        }
+        if (!blocked)
+            return false;
+    }
+    return true;
+}
+
 /*---------------------*/
 /*--RegularSalmonella--*/
 /*---------------------*/
@@ -771,6 +1276,13 @@ RegularSalmonella::RegularSalmonella(StudentWorld* studentWorld, double startX,
     : Salmonella(studentWorld, ID_REGULAR_SALMONELLA, startX, startY, 4, 1, false)
 {}
 
+// Clone the regular salmonella for another world
+Actor* RegularSalmonella::clone(StudentWorld* studentWorld) const {
+    RegularSalmonella* copy = new RegularSalmonella(studentWorld, getX(), getY());
+    copy->copyStateFrom(*this);
+    return copy;
+}
+
 /*---------------------*/
 /*-AggressiveSalmonella*/
 /*---------------------*/
@@ -780,6 +1292,13 @@ AggressiveSalmonella::AggressiveSalmonella(StudentWorld* studentWorld, double st
     : Salmonella(studentWorld, ID_AGGRESSIVE_SALMONELLA, startX, startY, 10, 2, true)
 {}
 
+// Clone the aggressive salmonella for another world
+Actor* AggressiveSalmonella::clone(StudentWorld* studentWorld) const {
+    AggressiveSalmonella* copy = new AggressiveSalmonella(studentWorld, getX(), getY());
+    copy->copyStateFrom(*this);
+    return copy;
+}
+
 /*---------------------*/
 /*--------Ecoli--------*/
 /*---------------------*/
@@ -789,6 +1308,13 @@ Ecoli::Ecoli(StudentWorld* studentWorld, double startX, double startY)
     : Bacteria(studentWorld, ID_ECOLI, IID_ECOLI, startX, startY, 5, 4, false, false)
 {}
 
+// Clone the ecoli for another world
+Actor* Ecoli::clone(StudentWorld* studentWorld) const {
+    Ecoli* copy = new Ecoli(studentWorld, getX(), getY());
+    copy->copyStateFrom(*this);
+    return copy;
+}
+
 // Ecoli plays sound when hurt
 void Ecoli::playHurtSound() const {
     studentWorld()->playSound(SOUND_ECOLI_HURT);
@@ -803,6 +1329,10 @@ void Ecoli::playDeadSound() const {
 // Final action performed by Ecoli whenever it is called to do something
 void Ecoli::finalAction() {
     
+    // An ecoli that could not move last time cannot move now either, unless the player or the dirt near it moved
+    if (isAsleep())
+        return;
+    
     // Obtain distance from Ecoli to player's current position
     double playerX = studentWorld()->player()->getX();
     double playerY = studentWorld()->player()->getY();
@@ -836,27 +1366,20 @@ void Ecoli::finalAction() {
             double x = 0;
             double y = 0;
             
-            // Check to see if path of 2 units in current direction is valid
+            // Check to see if path of 2 units (times the step scale) in current direction is valid
             bool freeMovement = true;
-            for (int j = 1; j <= 2; j++) {
+            for (int j = 1; j <= 2 * stepScale(); j++) {
                 getPositionInThisDirection((angle + i * 10) * 180 / M_PI, j, x, y);
-                Actor* tempEcoli = new Ecoli(studentWorld(), x, y);
                 
                 // Check if the path overlaps with any dirt piles
-                list<Actor*> overlapsInDirection;
-                studentWorld()->getOverlap(tempEcoli, overlapsInDirection, SPRITE_WIDTH/2);
-                for (list<Actor*>::iterator p = overlapsInDirection.begin(); p != overlapsInDirection.end(); p++) {
-                    if ((*p)->objectType() == ID_DIRT)
-                        freeMovement = false;
-                }
+                if (studentWorld()->isDirtAt(x, y, SPRITE_WIDTH/2))
+                    freeMovement = false;
                 
                 // Check if the path would cause the Ecoli to exit the petri dish
-                double distanceFromCenter = distance(x, y, VIEW_WIDTH/2, VIEW_HEIGHT/2);
-                if (distanceFromCenter >= VIEW_RADIUS)
+                double distanceFromCenter = distance(x, y, studentWorld()->dishCenterX(), studentWorld()->dishCenterY());
+                if (distanceFromCenter >= studentWorld()->dishRadius())
                     freeMovement = false;
                 
-                delete tempEcoli;
-                
                 if (!freeMovement)
                     break;
             }
@@ -868,4 +1391,8 @@ void Ecoli::finalAction() {
             }
         }
     }
+    
+    // Nothing changed, sleep if the dirt that blocked the ecoli is close enough for the world to wake it
+    if (2 * stepScale() + SPRITE_WIDTH/2 <= BACTERIA_SLEEP_REACH)
+        fallAsleep(stepScale());
 }
@@ -2,30 +2,93 @@
 #define ACTOR_H_
 
 #include "GraphObject.h"
+#include <cstddef>
 
 // Students:  Add code to this file, Actor.cpp, StudentWorld.h, and StudentWorld.cpp
 
 class StudentWorld;
+class LevelArena;
+struct RenderSprite;
 
-class Actor : public GraphObject {
+// Snapshot of the simulation state of a single actor, used to compare two worlds field by field
+struct ActorState {
+    static const int NUMBER_OF_COUNTERS = 3;
+    int id;
+    int objectType;
+    double x;
+    double y;
+    int direction;
+    bool active;
+    int hitPoints;
+    int counters[NUMBER_OF_COUNTERS];
+    const char* counterName(int index) const;
+};
+
+// The framework keeps every GraphObject in display lists shared by all worlds, so actors are created and destroyed
+// under one lock when forks run on other threads. It is taken before the GraphObject part of an actor is built and
+// released by the actor's constructor, and the other way around in the destructor
+class DisplayListLock {
+  protected:
+    DisplayListLock();
+    ~DisplayListLock();
+    static void lock();
+    static void unlock();
+};
+
+class Actor : private DisplayListLock, public GraphObject {
   public:
     Actor(StudentWorld* studentWorld, int objectType, int imageID, double startX, double startY, Direction dir = 0, int depth = 0, double size = 1.0);
-    virtual ~Actor() {}
+    virtual ~Actor();
     virtual void doSomething() = 0;
+    
+    // A copy of the actor for a forked world, with the same id and simulation state
+    virtual Actor* clone(StudentWorld* studentWorld) const = 0;
+    
+    // Actors are charged to their own category in allocation reports
+    static void* operator new(std::size_t size);
+    static void operator delete(void* pointer);
+    
+    // The long-lived actors of a level live in its arena, see LevelArena. Actors are destroyed through destroy, which
+    // leaves the memory of arena actors to their arena
+    static void* operator new(std::size_t size, LevelArena& arena);
+    static void operator delete(void* pointer, LevelArena& arena);
+    static void destroy(Actor* actor);
+    void setInArena();
     StudentWorld* studentWorld() const;
     int objectType() const;
+    unsigned int flags() const;
+    int id() const;
+    void setId(int id);
+    int record() const;
+    void setRecord(int record);
     bool isActive() const;
     void deactivate();
     virtual void takeDamage(int amount);
+    virtual void getState(ActorState& state) const;
+    
+    // Actors that stand in for several, like a flame burst for its flames, take an id for each of them and list a state
+    // and a sprite for each one still in play. Both are written to room for idCount of them, and their number is returned
+    virtual int idCount() const;
+    virtual int getStates(ActorState* states) const;
+    virtual int getSprites(RenderSprite* sprites) const;
+    
+    // Movement goes through the actor, so that the world's compact record of it stays up to date
+    void moveTo(double x, double y);
+    void moveAngle(Direction angle, int units = 1);
+    void moveForward(int units = 1);
+  protected:
+    void copyStateFrom(const Actor& other);
   private:
     StudentWorld* m_studentWorld;
-    bool m_active;
-    int m_objectType;
+    unsigned int m_flags;       // Object type, active and arena flags, packed as in the world's actor records
+    int m_id;
+    int m_record;
 };
 
 class Dirt : public Actor {
   public:
     Dirt(StudentWorld* studentWorld, double startX, double startY);
+    Actor* clone(StudentWorld* studentWorld) const;
     void doSomething();
   private:
 };
@@ -33,6 +96,7 @@ class Dirt : public Actor {
 class Food : public Actor {
   public:
     Food(StudentWorld* studentWorld, double startX, double startY);
+    Actor* clone(StudentWorld* studentWorld) const;
     void doSomething();
   private:
 };
@@ -40,12 +104,14 @@ class Food : public Actor {
 class Pit : public Actor {
   public:
     Pit(StudentWorld* studentWorld, double startX, double startY);
+    Actor* clone(StudentWorld* studentWorld) const;
     bool isEmpty() const;
     void doSomething();
+    void getState(ActorState& state) const;
   private:
-    int m_numberOfRegularSalmonella;
-    int m_numberOfAggressiveSalmonella;
-    int m_numberOfEColi;
+    unsigned char m_numberOfRegularSalmonella;
+    unsigned char m_numberOfAggressiveSalmonella;
+    unsigned char m_numberOfEColi;
 };
 
 class Projectile : public Actor {
@@ -53,63 +119,105 @@ class Projectile : public Actor {
     Projectile(StudentWorld* studentWorld, int objectType, int imageID, double startX, double startY, Direction dir, int maximumTravelDistance, int damage);
     virtual ~Projectile() {}
     void doSomething();
+    void getState(ActorState& state) const;
+  protected:
+    void copyStateFrom(const Projectile& other);
   private:
-    int m_distanceTraveled;
-    int m_maximumTravelDistance;
-    int m_damage;
-    
-    // Helper Function
-    bool damageableObject(int objectType) const;
+    short m_distanceTraveled;
+    short m_maximumTravelDistance;
+    short m_damage;
+    short m_dirtDistance;       // Dirt is not looked for until the projectile has traveled this far...
+    int m_dirtVersion;          // ...as worked out when the world's static version was this, -1 before it is worked out
 };
 
 class Spray : public Projectile {
   public:
     Spray(StudentWorld* studentWorld, double startX, double startY, Direction dir);
+    Actor* clone(StudentWorld* studentWorld) const;
   private:
 };
 
+// How far flames travel and the damage they do, and how many a flamethrower charge fires and the angle between them
+const int FLAME_MAX_DISTANCE    = 32;
+const int FLAME_DAMAGE          = 5;
+const int FLAME_BURST_RAYS      = 16;
+const int FLAME_BURST_SPREAD    = 22;
+
 class Flame : public Projectile {
   public:
     Flame(StudentWorld* studentWorld, double startX, double startY, Direction dir);
+    Actor* clone(StudentWorld* studentWorld) const;
+  private:
+};
+
+// The flames of one flamethrower charge as a single actor, fired by the player in headless worlds of the optimized engine
+// The flames travel outward as a ring, so each tick the burst looks up what they could hit with one query over that ring
+// instead of one query for each flame. Each flame still stops at the first actor it hits, and the burst takes an id and
+// lists a state for each flame, so the game and its state are exactly those of sixteen separate flames
+class FlameBurst : public Actor {
+  public:
+    FlameBurst(StudentWorld* studentWorld, double originX, double originY, Direction dir);
+    Actor* clone(StudentWorld* studentWorld) const;
+    void doSomething();
+    int idCount() const;
+    int getStates(ActorState* states) const;
+    int getSprites(RenderSprite* sprites) const;
   private:
+    struct Ray {
+        double x;
+        double y;
+        int direction;          // As the flame would have it, not wrapped to 0-359
+        bool inPlay;
+        short dirtDistance;     // See Projectile
+        int dirtVersion;
+    };
+    Ray m_rays[FLAME_BURST_RAYS];
+    short m_distanceTraveled;   // By every flame still in play
 };
 
 class Item : public Actor {
   public:
-    Item(StudentWorld* studentWorld, int objectType, int imageID, double startX, double startY, int ScoreChange, bool hasSound);
+    Item(StudentWorld* studentWorld, int objectType, int imageID, double startX, double startY, int ScoreChange, bool hasSound, int lifeTime = -1);
     virtual ~Item() {}
     void doSomething();
+    int lifeTime() const;
+    void age(int ticks);
+    void getState(ActorState& state) const;
     virtual void playerInteraction() = 0;
   private:
-    int m_lifeTime;
-    int m_scoreChange;
+    short m_lifeTime;
+    short m_scoreChange;
     bool m_hasSound;
 };
 
 class HealthGoodie : public Item {
 public:
-    HealthGoodie(StudentWorld* studentWorld, double startX, double startY);
+    HealthGoodie(StudentWorld* studentWorld, double startX, double startY, int lifeTime = -1);
+    Actor* clone(StudentWorld* studentWorld) const;
     void playerInteraction();
 private:
 };
 
 class FTGoodie : public Item {
   public:
-    FTGoodie(StudentWorld* studentWorld, double startX, double startY);
+    FTGoodie(StudentWorld* studentWorld, double startX, double startY, int lifeTime = -1);
+    Actor* clone(StudentWorld* studentWorld) const;
     void playerInteraction();
   private:
 };
 
 class LifeGoodie : public Item {
   public:
-    LifeGoodie(StudentWorld* studentWorld, double startX, double startY);
+    LifeGoodie(StudentWorld* studentWorld, double startX, double startY, int lifeTime = -1);
+    Actor* clone(StudentWorld* studentWorld) const;
     void playerInteraction();
   private:
 };
 
 class Fungus : public Item {
   public:
-    Fungus(StudentWorld* studentWorld, double startX, double startY);
+    Fungus(StudentWorld* studentWorld, double startX, double startY, int lifeTime = -1);
+    Actor* clone(StudentWorld* studentWorld) const;
     void playerInteraction();
   private:
 };
@@ -121,26 +229,37 @@ class Agent : public Actor {
     void takeDamage(int amount);
     void gainHitPoints(int amount);
     int hitPoints() const;
+    void getState(ActorState& state) const;
     virtual void playHurtSound() const = 0;
     virtual void playDeadSound() const = 0;
+  protected:
+    void copyStateFrom(const Agent& other);
   private:
-    int m_hitPoints;
+    short m_hitPoints;
 };
 
 class Socrates : public Agent {
   public:
     Socrates(StudentWorld* studentWorld, double startX, double startY);
+    Actor* clone(StudentWorld* studentWorld) const;
     void doSomething();
     void increaseFTCharges(int amount);
     void playHurtSound() const;
     void playDeadSound() const;
     int sprays() const;
     int ftCharges() const;
+    void getState(ActorState& state) const;
   private:
-    int m_sprays;
-    int m_FTcharges;
+    short m_sprays;
+    short m_FTcharges;
 };
 
+// A bacterium whose plan failed without changing anything sleeps until the world's version of its region changes, see
+// StudentWorld::sleepVersion. That only covers dirt up to a grid cell away, so only bacteria that look no further sleep.
+// Salmonella check whether they are boxed in on every side after this many blocked plans in a row
+const int BACTERIA_SLEEP_REACH      = 16;
+const int SALMONELLA_BOXED_CHECK    = 4;
+
 class Bacteria : public Agent {
   public:
     Bacteria(StudentWorld* studentWorld, int objectType, int imageID, double startX, double startY, int hitPoints, int damage, bool isAgressiveSalmonella, bool isSalmonella);
@@ -152,12 +271,25 @@ class Bacteria : public Agent {
     void resetMovementPlan();
     int movementPlan();
     void decreaseMovementPlan();
+    int stepScale() const;
+    void getState(ActorState& state) const;
+  protected:
+    void copyStateFrom(const Bacteria& other);
+    bool isAsleep();
+    void fallAsleep(int minimumScale);
+    bool countBlockedPlan();
+    void clearBlockedPlans();
   private:
-    int m_movementPlanDistance;
-    int m_damage;
-    int m_totalFood;
+    int m_sleepVersion;         // Asleep while the world's version of its region is still this, -1 while awake...
+    signed char m_sleepScale;   // ...and its step scale is at least this
+    signed char m_blockedPlans;
+    signed char m_movementPlanDistance;
+    signed char m_damage;
+    signed char m_totalFood;
     bool m_isAggressive;
     bool m_isSalmonella;
+    signed char m_stepScale;    // Regular steps that the current final action stands for
+    bool m_thinkPending;        // Skipped its turn to think because the AI budget ran out
 };
 
 class Salmonella : public Bacteria {
@@ -168,23 +300,27 @@ class Salmonella : public Bacteria {
     void playHurtSound() const;
     void playDeadSound() const;
   private:
+    bool isBoxedIn();
 };
 
 class RegularSalmonella : public Salmonella {
   public:
     RegularSalmonella(StudentWorld* studentWorld, double startX, double startY);
+    Actor* clone(StudentWorld* studentWorld) const;
   private:
 };
 
 class AggressiveSalmonella : public Salmonella {
   public:
     AggressiveSalmonella(StudentWorld* studentWorld, double startX, double startY);
+    Actor* clone(StudentWorld* studentWorld) const;
   private:
 };
 
 class Ecoli : public Bacteria {
   public:
     Ecoli(StudentWorld* studentWorld, double startX, double startY);
+    Actor* clone(StudentWorld* studentWorld) const;
     void finalAction();
     void playHurtSound() const;
     void playDeadSound() const;
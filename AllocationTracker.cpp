@@ -0,0 +1,126 @@
+#include "AllocationTracker.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+using namespace std;
+
+namespace {
+
+// Counters shared by every thread, updated with relaxed atomics since only the totals matter
+struct Counters {
+    atomic<long long> allocations[NUMBER_OF_ALLOCATION_CATEGORIES];
+    atomic<long long> bytes[NUMBER_OF_ALLOCATION_CATEGORIES];
+    atomic<long long> liveBytes;
+    atomic<long long> peakLiveBytes;
+};
+
+// Zero initialized before any dynamic initialization, so allocations made while the program starts are counted too
+Counters counters;
+
+}
+
+// Return the number of allocations in every category
+long long AllocationStats::totalAllocations() const {
+    long long total = 0;
+    for (int i = 0; i < NUMBER_OF_ALLOCATION_CATEGORIES; i++)
+        total += allocations[i];
+    return total;
+}
+
+// Return whether the program was built with allocation tracking
+bool allocationTrackingEnabled() {
+#ifdef TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Take a snapshot of the counters
+AllocationStats allocationStats() {
+    AllocationStats stats;
+    for (int i = 0; i < NUMBER_OF_ALLOCATION_CATEGORIES; i++) {
+        stats.allocations[i] = counters.allocations[i].load(memory_order_relaxed);
+        stats.bytes[i] = counters.bytes[i].load(memory_order_relaxed);
+    }
+    stats.liveBytes = counters.liveBytes.load(memory_order_relaxed);
+    stats.peakLiveBytes = counters.peakLiveBytes.load(memory_order_relaxed);
+    return stats;
+}
+
+// Start measuring the peak from the bytes live right now
+void resetPeakLiveBytes() {
+    counters.peakLiveBytes.store(counters.liveBytes.load(memory_order_relaxed), memory_order_relaxed);
+}
+
+// Return the name of an allocation category
+const char* allocationCategoryName(int category) {
+    static const char* const names[NUMBER_OF_ALLOCATION_CATEGORIES] = { "other", "actors", "queries", "engine", "hud" };
+    return (category >= 0 && category < NUMBER_OF_ALLOCATION_CATEGORIES) ? names[category] : "?";
+}
+
+// Allocate through the global operator new with the category in scope
+void* allocateInCategory(int category, size_t size) {
+    AllocationScope scope(category);
+    return ::operator new(size);
+}
+
+// Free memory from allocateInCategory
+void freeInCategory(void* pointer) {
+    ::operator delete(pointer);
+}
+
+#ifdef TRACK_ALLOCATIONS
+
+thread_local int currentAllocationCategory = ALLOC_OTHER;
+
+// Every block carries its size in a header, padded to keep the block as aligned as malloc's
+const size_t ALLOCATION_HEADER = alignof(max_align_t);
+
+// Count an allocation and hand out the memory after its header
+void* operator new(size_t size) {
+    void* block = malloc(size + ALLOCATION_HEADER);
+    if (block == nullptr)
+        throw bad_alloc();
+    *(size_t*) block = size;
+    int category = currentAllocationCategory;
+    counters.allocations[category].fetch_add(1, memory_order_relaxed);
+    counters.bytes[category].fetch_add(size, memory_order_relaxed);
+    long long live = counters.liveBytes.fetch_add(size, memory_order_relaxed) + size;
+    long long peak = counters.peakLiveBytes.load(memory_order_relaxed);
+    while (live > peak && !counters.peakLiveBytes.compare_exchange_weak(peak, live, memory_order_relaxed))
+        ;
+    return (char*) block + ALLOCATION_HEADER;
+}
+
+// Array allocations are counted the same way
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+// Release a block and its header
+void operator delete(void* pointer) noexcept {
+    if (pointer == nullptr)
+        return;
+    void* block = (char*) pointer - ALLOCATION_HEADER;
+    counters.liveBytes.fetch_sub(*(size_t*) block, memory_order_relaxed);
+    free(block);
+}
+
+// Release an array
+void operator delete[](void* pointer) noexcept {
+    operator delete(pointer);
+}
+
+// Sized deletes go through the header as well
+void operator delete(void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+// Sized array deletes go through the header as well
+void operator delete[](void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef ALLOCATIONTRACKER_H_
+#define ALLOCATIONTRACKER_H_
+
+#include <cstddef>
+
+// Allocation accounting for headless builds
+// Building with -DTRACK_ALLOCATIONS replaces the global operator new and delete with versions that count allocations,
+// bytes and live bytes, charged to the category of the innermost AllocationScope of the allocating thread
+// Without it the scopes compile to nothing and no statistics are kept
+
+const int ALLOC_OTHER                       = 0;    // Includes the framework's display list entries of new actors
+const int ALLOC_ACTORS                      = 1;    // Actor objects
+const int ALLOC_QUERIES                     = 2;    // Overlap query results
+const int ALLOC_ENGINE                      = 3;    // List of actors, actor records, broadphase and spawn buffers
+const int ALLOC_HUD                         = 4;    // Game text shown at the top of the screen
+const int NUMBER_OF_ALLOCATION_CATEGORIES   = 5;
+
+// Totals since the program started, over every thread
+struct AllocationStats {
+    long long allocations[NUMBER_OF_ALLOCATION_CATEGORIES];
+    long long bytes[NUMBER_OF_ALLOCATION_CATEGORIES];
+    long long liveBytes;
+    long long peakLiveBytes;
+    long long totalAllocations() const;
+};
+
+bool allocationTrackingEnabled();
+AllocationStats allocationStats();
+void resetPeakLiveBytes();
+const char* allocationCategoryName(int category);
+
+// Allocate memory charged to a category, and free it. Classes with their own operator new and delete forward both here,
+// so that the two always pair up in the same translation unit
+void* allocateInCategory(int category, std::size_t size);
+void freeInCategory(void* pointer);
+
+// Charges the allocations of the current thread to a category while in scope
+class AllocationScope {
+  public:
+    AllocationScope(int category);
+    ~AllocationScope();
+  private:
+    int m_previous;
+};
+
+#ifdef TRACK_ALLOCATIONS
+
+extern thread_local int currentAllocationCategory;
+
+inline AllocationScope::AllocationScope(int category)
+    : m_previous(currentAllocationCategory)
+{
+    currentAllocationCategory = category;
+}
+
+inline AllocationScope::~AllocationScope() {
+    currentAllocationCategory = m_previous;
+}
+
+#else
+
+inline AllocationScope::AllocationScope(int)
+    : m_previous(ALLOC_OTHER)
+{}
+
+inline AllocationScope::~AllocationScope() {}
+
+#endif
+
+#endif // ALLOCATIONTRACKER_H_
@@ -0,0 +1,1477 @@
+#include "Benchmark.h"
+#include "StudentWorld.h"
+#include "Actor.h"
+#include "BotInput.h"
+#include "PhaseProfiler.h"
+#include "AllocationTracker.h"
+#include "Telemetry.h"
+#include "VectorEnvironment.h"
+#include "OccupancyGrid.h"
+#include "RewindBuffer.h"
+#include "RenderBuffer.h"
+#include "QueryProfiler.h"
+#include "GameConstants.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <sstream>
+#include <fstream>
+#include <math.h>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <random>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+using namespace std;
+
+/*---------------------*/
+/*-------Helpers-------*/
+/*---------------------*/
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+// Hardware counter of the cache misses of the calling thread, where the system lets it be read
+class CacheMissCounter {
+  public:
+    CacheMissCounter()
+        : m_fd(-1)
+    {
+#ifdef __linux__
+        perf_event_attr attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+        attributes.disabled = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        m_fd = (int) syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+#endif
+    }
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (m_fd >= 0)
+            close(m_fd);
+#endif
+    }
+    bool available() const {
+        return m_fd >= 0;
+    }
+    void start() {
+#ifdef __linux__
+        if (m_fd >= 0) {
+            ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    // Stop counting and return the misses since start
+    long long stop() {
+        long long count = 0;
+#ifdef __linux__
+        if (m_fd >= 0) {
+            ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(m_fd, &count, sizeof(count)) != sizeof(count))
+                count = 0;
+        }
+#endif
+        return count;
+    }
+  private:
+    int m_fd;
+};
+
+// Return the seconds elapsed between two time points
+double secondsBetween(Clock::time_point start, Clock::time_point end) {
+    return chrono::duration<double>(end - start).count();
+}
+
+// Get a random point within the petri dish, at most maxRadius away from the center
+void randomPointInDish(StudentWorld& world, double& x, double& y, double maxRadius) {
+    double theta = world.randInt(0, 35999) * M_PI / 18000;
+    double r = maxRadius * sqrt(world.randInt(0, 10000) / 10000.0);
+    x = r * cos(theta) + world.dishCenterX();
+    y = r * sin(theta) + world.dishCenterY();
+}
+
+// Add n bacteria of one type at random points in the dish
+void addBacteria(StudentWorld& world, int objectType, int n) {
+    double x;
+    double y;
+    for (int i = 0; i < n; i++) {
+        randomPointInDish(world, x, y, world.worldConfig().placementRadius);
+        if (objectType == ID_REGULAR_SALMONELLA)
+            world.addActor(new RegularSalmonella(&world, x, y));
+        else if (objectType == ID_AGGRESSIVE_SALMONELLA)
+            world.addActor(new AggressiveSalmonella(&world, x, y));
+        else
+            world.addActor(new Ecoli(&world, x, y));
+    }
+}
+
+// Add n food objects at random points in the dish
+void addFood(StudentWorld& world, int n) {
+    double x;
+    double y;
+    for (int i = 0; i < n; i++) {
+        randomPointInDish(world, x, y, world.worldConfig().placementRadius);
+        world.addActor(new Food(&world, x, y));
+    }
+}
+
+// Add spray projectiles until n of them are in flight
+void topUpSprays(StudentWorld& world, int n) {
+    double x;
+    double y;
+    for (int i = world.numberOfActors(ID_SPRAY); i < n; i++) {
+        randomPointInDish(world, x, y, world.worldConfig().placementRadius);
+        world.addActor(new Spray(&world, x, y, world.randInt(0, 359)));
+    }
+}
+
+/*---------------------*/
+/*------Scenarios------*/
+/*---------------------*/
+
+void refreshProjectiles(StudentWorld& world, int n);
+
+void populateRegularSalmonella(StudentWorld& world, int n) {
+    addBacteria(world, ID_REGULAR_SALMONELLA, n);
+}
+
+void populateAggressiveSalmonella(StudentWorld& world, int n) {
+    addBacteria(world, ID_AGGRESSIVE_SALMONELLA, n);
+}
+
+void populateEcoli(StudentWorld& world, int n) {
+    addBacteria(world, ID_ECOLI, n);
+}
+
+// n dirt piles laid out as concentric walls, with a fixed number of salmonella probing them
+void populateDirtWalls(StudentWorld& world, int n) {
+    const int rings = 6;
+    double totalCircumference = 0;
+    for (int ring = 0; ring < rings; ring++)
+        totalCircumference += 2 * M_PI * (20 + ring * 18);
+
+    int placed = 0;
+    for (int ring = 0; ring < rings && placed < n; ring++) {
+        double radius = 20 + ring * 18;
+        int inRing = (ring == rings - 1) ? n - placed : (int) (n * 2 * M_PI * radius / totalCircumference);
+        for (int i = 0; i < inRing; i++) {
+            double theta = 2 * M_PI * i / inRing;
+            world.addActor(new Dirt(&world, radius * cos(theta) + world.dishCenterX(), radius * sin(theta) + world.dishCenterY()));
+        }
+        placed += inRing;
+    }
+    addBacteria(world, ID_REGULAR_SALMONELLA, 32);
+}
+
+// n sprays in flight among a fixed field of dirt and ecoli, both refilled as they are destroyed
+void populateProjectiles(StudentWorld& world, int n) {
+    double x;
+    double y;
+    for (int i = 0; i < 100; i++) {
+        randomPointInDish(world, x, y, world.worldConfig().placementRadius);
+        world.addActor(new Dirt(&world, x, y));
+    }
+    refreshProjectiles(world, n);
+}
+
+void refreshProjectiles(StudentWorld& world, int n) {
+    addBacteria(world, ID_ECOLI, 50 - world.numberOfActors(ID_ECOLI));
+    topUpSprays(world, n);
+}
+
+// n food objects scattered around a fixed number of foraging salmonella
+void populateFoodSaturated(StudentWorld& world, int n) {
+    addFood(world, n);
+    addBacteria(world, ID_REGULAR_SALMONELLA, 32);
+}
+
+// n bacteria that each sit on three pieces of food, so every one of them reproduces
+void populateReproduction(StudentWorld& world, int n) {
+    double x;
+    double y;
+    for (int i = 0; i < n; i++) {
+        randomPointInDish(world, x, y, world.worldConfig().placementRadius - 10);
+        for (int j = 0; j < 3; j++)
+            world.addActor(new Food(&world, x, y));
+        int type = i % 3;
+        if (type == 0)
+            world.addActor(new RegularSalmonella(&world, x, y));
+        else if (type == 1)
+            world.addActor(new AggressiveSalmonella(&world, x, y));
+        else
+            world.addActor(new Ecoli(&world, x, y));
+    }
+}
+
+// n bacteria, salmonella and ecoli in turn, each boxed in by a ring of dirt close enough to block every step it tries
+void populateBoxedBacteria(StudentWorld& world, int n) {
+    const int ringDirt = 8;
+    const double ringRadius = 5;
+    double x;
+    double y;
+    for (int i = 0; i < n; i++) {
+        randomPointInDish(world, x, y, world.worldConfig().placementRadius - 10);
+        for (int j = 0; j < ringDirt; j++) {
+            double theta = 2 * M_PI * j / ringDirt;
+            world.addActor(new Dirt(&world, x + ringRadius * cos(theta), y + ringRadius * sin(theta)));
+        }
+        if (i % 2 == 0)
+            world.addActor(new RegularSalmonella(&world, x, y));
+        else
+            world.addActor(new Ecoli(&world, x, y));
+    }
+}
+
+// Play regular levels for a number of ticks, in batches of ticksPerBatch fast-forwarded ticks or tick by tick if it is 0,
+// starting the next level or game whenever one ends. Returns the hash of the final state
+unsigned long long playLevels(StudentWorld& world, int ticks, int ticksPerBatch) {
+    world.init();
+    int played = 0;
+    while (played < ticks) {
+        int status;
+        if (ticksPerBatch > 0) {
+            int batch;
+            status = world.fastForward(min(ticksPerBatch, ticks - played), batch);
+            played += batch;
+        }
+        else {
+            status = world.move();
+            played++;
+        }
+        if (status != GWSTATUS_CONTINUE_GAME) {
+            world.cleanUp();
+            if (world.isGameOver())
+                break;
+            if (status == GWSTATUS_FINISHED_LEVEL)
+                world.advanceToNextLevel();
+            world.init();
+        }
+    }
+    return world.stateHash();
+}
+
+// Set up a headless world for the bot to play regular levels in
+void setUpBotWorld(StudentWorld& world, BotInput& bot, unsigned int seed, const WorldConfig& config) {
+    world.seedRandom(seed);
+    world.setWorldConfig(config);
+    world.setInputSource(&bot);
+}
+
+// Play regular levels tick by tick until a number of ticks have been played or the game is over, starting the next level
+// or the same one again whenever one ends. playTick(tick) plays the tick of that number, counting from 1, through move
+// and returns its status. levelStarted() is called after each level is initialized, the first one included. Returns
+// the number of ticks played
+template <typename PlayTick, typename LevelStarted>
+int playBotLevels(StudentWorld& world, int ticks, PlayTick playTick, LevelStarted levelStarted) {
+    world.init();
+    levelStarted();
+    int played = 0;
+    while (played < ticks) {
+        int status = playTick(++played);
+        if (status != GWSTATUS_CONTINUE_GAME) {
+            world.cleanUp();
+            if (world.isGameOver())
+                break;
+            if (status == GWSTATUS_FINISHED_LEVEL)
+                world.advanceToNextLevel();
+            world.init();
+            levelStarted();
+        }
+    }
+    return played;
+}
+
+// Stand in for a display drawing a frame: the corners of every sprite's quad, turned to its direction, a few times over
+double drawFrame(const RenderFrame& frame) {
+    const int DRAW_PASSES = 8;
+    double sum = 0;
+    for (int pass = 0; pass < DRAW_PASSES; pass++) {
+        for (size_t i = 0; i < frame.sprites.size(); i++) {
+            const RenderSprite& sprite = frame.sprites[i];
+            double angle = (sprite.direction + pass) * M_PI / 180;
+            double c = cos(angle) * sprite.size * SPRITE_RADIUS;
+            double s = sin(angle) * sprite.size * SPRITE_RADIUS;
+            sum += (sprite.x + c - s) + (sprite.y + s + c) + sprite.depth;
+        }
+    }
+    return sum;
+}
+
+// Hash everything a frame holds, to tell a frame the display read apart from the one the world wrote
+unsigned long long frameHash(const RenderFrame& frame) {
+    unsigned long long hash = 14695981039346656037ULL;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = (const unsigned char*) data;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+    int fields[] = { frame.tick, frame.level, (int) frame.score, frame.lives };
+    mix(fields, sizeof(fields));
+    if (!frame.sprites.empty())
+        mix(frame.sprites.data(), frame.sprites.size() * sizeof(RenderSprite));
+    return hash;
+}
+
+}
+
+// Return every scenario of the benchmark suite
+const vector<Scenario>& benchmarkScenarios() {
+    static const vector<Scenario> scenarios = {
+        { "regular_salmonella",    populateRegularSalmonella,    nullptr },
+        { "aggressive_salmonella", populateAggressiveSalmonella, nullptr },
+        { "ecoli",                 populateEcoli,                nullptr },
+        { "dirt_walls",            populateDirtWalls,            nullptr },
+        { "projectiles",           populateProjectiles,          refreshProjectiles },
+        { "food_saturated",        populateFoodSaturated,        nullptr },
+        { "reproduction",          populateReproduction,         nullptr },
+        { "boxed_bacteria",        populateBoxedBacteria,        nullptr },
+    };
+    return scenarios;
+}
+
+/*---------------------*/
+/*-------Runners-------*/
+/*---------------------*/
+
+// Default options: 50 ticks or 2 seconds per run, full AI detail
+BenchmarkOptions::BenchmarkOptions()
+    : maxTicks(50), timeBudgetSeconds(2.0), aiLevelOfDetail(false), aiBudget(0), bot(false), worldConfig(defaultWorldConfig())
+{}
+
+// Run one scenario at size n until maxTicks have passed or the time budget is used up
+// Only the calls to move are timed, the player is healed between ticks so that the workload survives
+ScenarioResult runScenario(const Scenario& scenario, int n, const BenchmarkOptions& options) {
+    StudentWorld world("", true);
+    BotInput bot(1);
+    world.seedRandom(1);
+    world.setWorldConfig(options.worldConfig);
+    if (options.bot)
+        world.setInputSource(&bot);
+    if (options.aiLevelOfDetail) {
+        AILevelOfDetail settings = world.aiLevelOfDetail();
+        settings.enabled = true;
+        settings.budget = options.aiBudget;
+        world.setAILevelOfDetail(settings);
+    }
+    world.initEmptyDish();
+    scenario.populate(world, n);
+
+    ScenarioResult result;
+    result.scenario = scenario.name;
+    result.n = n;
+    result.ticks = 0;
+    result.status = GWSTATUS_CONTINUE_GAME;
+
+    double tickSeconds = 0;
+    double actorTicks = 0;
+    Clock::time_point budgetStart = Clock::now();
+    while (result.ticks < options.maxTicks && secondsBetween(budgetStart, Clock::now()) < options.timeBudgetSeconds) {
+        if (scenario.refresh != nullptr)
+            scenario.refresh(world, n);
+        world.player()->gainHitPoints(100);
+        actorTicks += world.numberOfActors();
+
+        Clock::time_point start = Clock::now();
+        int status = world.move();
+        tickSeconds += secondsBetween(start, Clock::now());
+        result.ticks++;
+
+        if (status != GWSTATUS_CONTINUE_GAME) {
+            result.status = status;
+            break;
+        }
+    }
+
+    result.actors = world.numberOfActors();
+    result.microsecondsPerTick = tickSeconds * 1e6 / result.ticks;
+    result.nanosecondsPerActorTick = (actorTicks > 0) ? tickSeconds * 1e9 / actorTicks : 0;
+    return result;
+}
+
+// Report the bytes each kind of actor takes, and how many compact records fit in a cache line
+void reportActorLayout(ostream& out) {
+    const int cacheLine = 64;
+    out << "layout\tbytes" << endl;
+    out << "ActorRecord\t" << sizeof(ActorRecord) << "\t(" << cacheLine / sizeof(ActorRecord) << " per " << cacheLine << " byte cache line)" << endl;
+    out << "Dirt\t" << sizeof(Dirt) << endl;
+    out << "Food\t" << sizeof(Food) << endl;
+    out << "Pit\t" << sizeof(Pit) << endl;
+    out << "Spray\t" << sizeof(Spray) << endl;
+    out << "Flame\t" << sizeof(Flame) << endl;
+    out << "HealthGoodie\t" << sizeof(HealthGoodie) << endl;
+    out << "Socrates\t" << sizeof(Socrates) << endl;
+    out << "RegularSalmonella\t" << sizeof(RegularSalmonella) << endl;
+    out << "AggressiveSalmonella\t" << sizeof(AggressiveSalmonella) << endl;
+    out << "Ecoli\t" << sizeof(Ecoli) << endl;
+    out << endl;
+}
+
+// Run every scenario for every size and report tick cost against n
+void runScenarioSweep(const vector<int>& sizes, const BenchmarkOptions& options, ostream& out) {
+    reportActorLayout(out);
+    out << "scenario\tn\tactors\tticks\tus/tick\tns/actor-tick\tnote" << endl;
+    const vector<Scenario>& scenarios = benchmarkScenarios();
+    for (size_t i = 0; i < scenarios.size(); i++) {
+        for (size_t j = 0; j < sizes.size(); j++) {
+            ScenarioResult result = runScenario(scenarios[i], sizes[j], options);
+            out << result.scenario << '\t' << result.n << '\t' << result.actors << '\t' << result.ticks << '\t'
+                << fixed << setprecision(1) << result.microsecondsPerTick << '\t'
+                << result.nanosecondsPerActorTick << '\t';
+            if (result.status == GWSTATUS_PLAYER_DIED)
+                out << "player died";
+            else if (result.status == GWSTATUS_FINISHED_LEVEL)
+                out << "level finished";
+            out << endl;
+        }
+    }
+}
+
+// Play real levels with the bot until the game is over or maxLevels levels are done
+// A level that runs past maxTicksPerLevel counts as finished, so that a stalemate cannot stall the run
+// The time init and cleanUp take is the pause between one level and the next
+void runSoak(int maxLevels, int maxTicksPerLevel, unsigned int seed, const WorldConfig& config, bool pregenerateLevels, ostream& out) {
+    StudentWorld world("", true);
+    BotInput bot(seed);
+    world.seedRandom(seed);
+    world.setWorldConfig(config);
+    world.setLevelPregeneration(pregenerateLevels);
+    world.setInputSource(&bot);
+
+    out << "level\tticks\tresult\tscore\tlives\tpeak actors\tus/tick\tmax us/tick\tinit us\tcleanup us" << endl;
+    out << fixed << setprecision(1);
+    for (int levelsPlayed = 0; levelsPlayed < maxLevels && !world.isGameOver(); levelsPlayed++) {
+        Clock::time_point initStart = Clock::now();
+        world.init();
+        double initSeconds = secondsBetween(initStart, Clock::now());
+        int status = GWSTATUS_CONTINUE_GAME;
+        int ticks = 0;
+        int peakActors = world.numberOfActors();
+        double totalSeconds = 0;
+        double maxSeconds = 0;
+        while (status == GWSTATUS_CONTINUE_GAME && ticks < maxTicksPerLevel) {
+            Clock::time_point start = Clock::now();
+            status = world.move();
+            double seconds = secondsBetween(start, Clock::now());
+            totalSeconds += seconds;
+            maxSeconds = max(maxSeconds, seconds);
+            peakActors = max(peakActors, world.numberOfActors());
+            ticks++;
+        }
+
+        const char* result = (status == GWSTATUS_PLAYER_DIED) ? "died" : (status == GWSTATUS_FINISHED_LEVEL) ? "finished" : "timed out";
+        out << world.getLevel() << '\t' << ticks << '\t' << result << '\t' << world.getScore() << '\t' << world.getLives() << '\t'
+            << peakActors << '\t' << totalSeconds * 1e6 / ticks << '\t' << maxSeconds * 1e6 << '\t' << initSeconds * 1e6 << '\t';
+
+        Clock::time_point cleanUpStart = Clock::now();
+        world.cleanUp();
+        out << secondsBetween(cleanUpStart, Clock::now()) * 1e6 << endl;
+        if (status != GWSTATUS_PLAYER_DIED)
+            world.advanceToNextLevel();
+    }
+}
+
+// Fork a level in progress over and over, check that a fork plays on exactly like the world it came from,
+// then play a batch of forks for a number of ticks each, one after another and then on every hardware thread
+void runForkBenchmark(int branches, int depth, unsigned int seed, const WorldConfig& config, ostream& out) {
+    StudentWorld world("", true);
+    BotInput bot(seed);
+    world.seedRandom(seed);
+    world.setWorldConfig(config);
+    world.setInputSource(&bot);
+    world.init();
+    for (int tick = 0; tick < 100 && world.move() == GWSTATUS_CONTINUE_GAME; tick++)
+        ;
+    out << fixed << setprecision(2);
+    out << "forking a level with " << world.numberOfActors() << " actors at tick " << world.ticks() << endl;
+    
+    // Cost of a fork on its own
+    const int forks = 2000;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < forks; i++)
+        delete world.fork();
+    double seconds = secondsBetween(start, Clock::now());
+    out << "fork and delete	" << seconds * 1e6 / forks << " us	" << forks / seconds << " forks/s" << endl;
+    
+    // A fork and its parent, played by identical bots, must stay identical while both copy what they change
+    StudentWorld* fork = world.fork();
+    BotInput parentBot(seed + 1);
+    BotInput forkBot(seed + 1);
+    world.setInputSource(&parentBot);
+    fork->setInputSource(&forkBot);
+    bool identical = true;
+    for (int tick = 0; tick < depth && identical; tick++) {
+        int status = world.move();
+        identical = (fork->move() == status && fork->stateHash() == world.stateHash());
+        if (status != GWSTATUS_CONTINUE_GAME)
+            break;
+    }
+    out << "fork matches parent over " << depth << " ticks	" << (identical ? "yes" : "no") << endl;
+    delete fork;
+    
+    // Branches of a look-ahead search, each played by a differently seeded bot
+    for (int threads = 1; threads <= 2; threads++) {
+        int workers = (threads == 1) ? 1 : max(2, (int) thread::hardware_concurrency());
+        vector<unique_ptr<StudentWorld>> worlds;
+        vector<unique_ptr<BotInput>> bots;
+        start = Clock::now();
+        for (int b = 0; b < branches; b++) {
+            worlds.emplace_back(world.fork());
+            bots.emplace_back(new BotInput(seed + 2 + b));
+            worlds[b]->setInputSource(bots[b].get());
+        }
+        atomic<int> next(0);
+        atomic<long> ticksPlayed(0);
+        auto playBranches = [&]() {
+            for (int b = next++; b < branches; b = next++) {
+                for (int tick = 0; tick < depth; tick++) {
+                    ticksPlayed++;
+                    if (worlds[b]->move() != GWSTATUS_CONTINUE_GAME)
+                        break;
+                }
+            }
+        };
+        vector<thread> pool;
+        for (int w = 1; w < workers; w++)
+            pool.emplace_back(playBranches);
+        playBranches();
+        for (size_t w = 0; w < pool.size(); w++)
+            pool[w].join();
+        worlds.clear();
+        seconds = secondsBetween(start, Clock::now());
+        out << branches << " branches x " << depth << " ticks on " << workers << " thread(s)	" << seconds * 1e3 << " ms	" << ticksPlayed / seconds << " branch ticks/s" << endl;
+    }
+}
+
+// Step a vector environment with random actions, first on the calling thread alone and then on the whole pool
+// The actions only depend on the seed, so both runs must see the same observations, rewards and episode ends
+bool runVectorBenchmark(int worlds, int steps, unsigned int seed, const WorldConfig& config, ostream& out) {
+    vector<int> actions(worlds);
+    vector<float> observations(worlds * OBSERVATION_SIZE);
+    vector<float> rewards(worlds);
+    vector<unsigned char> dones(worlds);
+    double checksums[2];
+    out << fixed << setprecision(2);
+    for (int run = 0; run < 2; run++) {
+        VectorEnvironment environment(worlds, seed, (run == 0) ? 1 : max(2, (int) thread::hardware_concurrency()), config);
+        mt19937 random(seed);
+        uniform_int_distribution<int> action(0, NUMBER_OF_ACTIONS - 1);
+        environment.reset(observations.data());
+        double checksum = 0;
+        long episodes = 0;
+        Clock::time_point start = Clock::now();
+        for (int step = 0; step < steps; step++) {
+            for (int i = 0; i < worlds; i++)
+                actions[i] = action(random);
+            environment.step(actions.data(), observations.data(), rewards.data(), dones.data());
+            for (int i = 0; i < worlds; i++) {
+                checksum += rewards[i] + dones[i];
+                episodes += dones[i];
+            }
+            checksum += observations[step % observations.size()];
+        }
+        double seconds = secondsBetween(start, Clock::now());
+        checksums[run] = checksum;
+        out << worlds << " worlds x " << steps << " steps on " << environment.threads() << " thread(s)\t" << seconds * 1e3 << " ms\t"
+            << (double) worlds * steps / seconds << " world steps/s\t" << episodes << " episodes" << endl;
+    }
+    bool identical = (checksums[0] == checksums[1]);
+    out << "pool matches one thread\t" << (identical ? "yes" : "no") << endl;
+    return identical;
+}
+
+// Play the same levels twice with the same bot, first leaving the records in list order and then keeping them in Morton
+// order, timing the ticks and counting the cache misses of each run. Both runs must end in the same state
+bool runLocalityBenchmark(int ticks, unsigned int seed, const WorldConfig& config, ostream& out) {
+    CacheMissCounter counter;
+    unsigned long long hashes[2];
+    out << fixed << setprecision(2);
+    out << "records\tticks\tpeak actors\tus/tick\treorders\tcache misses/tick" << endl;
+    for (int run = 0; run < 2; run++) {
+        StudentWorld world("", true);
+        BotInput bot(seed);
+        world.seedRandom(seed);
+        world.setWorldConfig(config);
+        world.setInputSource(&bot);
+        world.setSpatialReordering(run == 1);
+        world.init();
+        int peakActors = world.numberOfActors();
+        long long misses = 0;
+        double seconds = 0;
+        for (int tick = 0; tick < ticks; tick++) {
+            counter.start();
+            Clock::time_point start = Clock::now();
+            int status = world.move();
+            seconds += secondsBetween(start, Clock::now());
+            misses += counter.stop();
+            peakActors = max(peakActors, world.numberOfActors());
+            if (status != GWSTATUS_CONTINUE_GAME) {
+                world.cleanUp();
+                if (world.isGameOver())
+                    break;
+                if (status == GWSTATUS_FINISHED_LEVEL)
+                    world.advanceToNextLevel();
+                world.init();
+            }
+        }
+        hashes[run] = world.stateHash();
+        out << ((run == 0) ? "list order" : "morton order") << '\t' << ticks << '\t' << peakActors << '\t' << seconds * 1e6 / ticks << '\t'
+            << world.reorders() << '\t';
+        if (counter.available())
+            out << (double) misses / ticks << endl;
+        else
+            out << "n/a" << endl;
+    }
+    bool identical = (hashes[0] == hashes[1]);
+    out << "same game in both orders\t" << (identical ? "yes" : "no") << endl;
+    return identical;
+}
+
+// Play the same levels tick by tick and fast-forwarded, with nobody at the controls and with the bot playing
+bool runFastForwardBenchmark(int ticks, int ticksPerBatch, unsigned int seed, const WorldConfig& config, ostream& out) {
+    bool allIdentical = true;
+    out << fixed << setprecision(2);
+    out << "player\tticks\ttick by tick ms\tfast-forward ms\tspeedup\tticks jumped\tidentical" << endl;
+    for (int withBot = 0; withBot < 2; withBot++) {
+        double seconds[2];
+        unsigned long long hashes[2];
+        int jumped = 0;
+        for (int run = 0; run < 2; run++) {
+            StudentWorld world("", true);
+            BotInput bot(seed);
+            world.seedRandom(seed);
+            world.setWorldConfig(config);
+            if (withBot)
+                world.setInputSource(&bot);
+            Clock::time_point start = Clock::now();
+            hashes[run] = playLevels(world, ticks, (run == 0) ? 0 : ticksPerBatch);
+            seconds[run] = secondsBetween(start, Clock::now());
+            jumped = world.jumpedTicks();
+        }
+        bool identical = (hashes[0] == hashes[1]);
+        allIdentical = allIdentical && identical;
+        out << (withBot ? "bot" : "idle") << '\t' << ticks << '\t' << seconds[0] * 1e3 << '\t' << seconds[1] * 1e3 << '\t'
+            << seconds[0] / seconds[1] << '\t' << jumped << '\t' << (identical ? "yes" : "no") << endl;
+    }
+    return allIdentical;
+}
+
+// Play the bot on regular levels twice from the same seed, the second time recording a rewind history. Every
+// REWIND_CHECK_INTERVAL ticks the second run rewinds rewindTicks ticks and compares the rewound world with the state it
+// had then. Only the calls to move are timed
+bool runRewindBenchmark(int ticks, int rewindTicks, unsigned int seed, const WorldConfig& config, ostream& out) {
+    const size_t REWIND_BUDGET = 8 << 20;
+    const int REWIND_CHECK_INTERVAL = 250;
+    double seconds[2];
+    int played[2];
+    int rewinds = 0;
+    int mismatches = 0;
+    double rewindSeconds = 0;
+    double maxRewindSeconds = 0;
+    size_t memoryUsed = 0;
+    for (int run = 0; run < 2; run++) {
+        StudentWorld world("", true);
+        BotInput bot(seed);
+        RewindBuffer rewind(REWIND_BUDGET);
+        world.seedRandom(seed);
+        world.setWorldConfig(config);
+        world.setInputSource(&bot);
+        if (run == 1)
+            world.setRewind(&rewind);
+        world.init();
+        seconds[run] = 0;
+        played[run] = 0;
+        int expectedTick = -1;
+        unsigned long long expectedHash = 0;
+        while (played[run] < ticks) {
+            played[run]++;
+            Clock::time_point start = Clock::now();
+            int status = world.move();
+            seconds[run] += secondsBetween(start, Clock::now());
+            if (status != GWSTATUS_CONTINUE_GAME) {
+                world.cleanUp();
+                if (world.isGameOver())
+                    break;
+                if (status == GWSTATUS_FINISHED_LEVEL)
+                    world.advanceToNextLevel();
+                world.init();
+                expectedTick = -1;
+                continue;
+            }
+            if (run == 0)
+                continue;
+            if ((played[run] + rewindTicks) % REWIND_CHECK_INTERVAL == 0) {
+                expectedTick = world.ticks();
+                expectedHash = world.stateHash();
+            }
+            if (played[run] % REWIND_CHECK_INTERVAL == 0 && expectedTick >= 0) {
+                start = Clock::now();
+                StudentWorld* rewound = rewind.rewindTo(expectedTick);
+                double rewindTime = secondsBetween(start, Clock::now());
+                rewinds++;
+                rewindSeconds += rewindTime;
+                maxRewindSeconds = max(maxRewindSeconds, rewindTime);
+                if (rewound == nullptr || rewound->stateHash() != expectedHash)
+                    mismatches++;
+                delete rewound;
+                expectedTick = -1;
+            }
+            memoryUsed = max(memoryUsed, rewind.memoryUsed());
+        }
+    }
+    out << fixed << setprecision(2);
+    out << "us/tick without history\t" << seconds[0] * 1e6 / played[0] << endl;
+    out << "us/tick with history\t" << seconds[1] * 1e6 / played[1] << "\t(" << (seconds[1] / seconds[0] - 1) * 100 << "% overhead)" << endl;
+    out << "peak memory\t" << memoryUsed / 1024.0 << " KB of " << REWIND_BUDGET / 1024 << " KB" << endl;
+    if (rewinds > 0)
+        out << "rewinds of " << rewindTicks << " ticks\t" << rewinds << "\tmean " << rewindSeconds * 1e3 / rewinds << " ms\tmax " << maxRewindSeconds * 1e3 << " ms" << endl;
+    out << "rewound worlds match\t" << ((mismatches == 0) ? "yes" : "no") << endl;
+    return mismatches == 0;
+}
+
+// Play the bot's game twice: drawing each frame right after its tick on the same thread, then publishing the frames to
+// a display thread that draws the newest one whenever it is done with the last
+bool runRenderBenchmark(int ticks, unsigned int seed, const WorldConfig& config, ostream& out) {
+    double seconds[2];
+    int played[2];
+    vector<unsigned long long> expected(1, 0);      // Hash of each frame, by its number
+    long long drawn = 0;
+    long long torn = 0;
+    long long published = 0;
+    double sink = 0;
+    for (int run = 0; run < 2; run++) {
+        StudentWorld world("", true);
+        BotInput bot(seed);
+        RenderBuffer render;
+        RenderFrame frame;
+        world.seedRandom(seed);
+        world.setWorldConfig(config);
+        world.setInputSource(&bot);
+        atomic<bool> done(false);
+        thread display;
+        if (run == 1) {
+            world.setRenderBuffer(&render);
+            display = thread([&render, &done, &expected, &drawn, &torn, &sink]() {
+                long long last = 0;
+                while (true) {
+                    bool finished = done.load();
+                    const RenderFrame* newest = render.newestFrame();
+                    if (newest != nullptr && newest->number != last) {
+                        last = newest->number;
+                        sink += drawFrame(*newest);
+                        drawn++;
+                        if (frameHash(*newest) != expected[last])
+                            torn++;
+                    }
+                    else if (finished)
+                        break;
+                    else
+                        this_thread::yield();
+                }
+            });
+        }
+        Clock::time_point start = Clock::now();
+        world.init();
+        if (run == 0) {
+            world.renderFrame(frame);
+            sink += drawFrame(frame);
+            expected.push_back(frameHash(frame));
+        }
+        played[run] = 0;
+        while (played[run] < ticks) {
+            played[run]++;
+            int status = world.move();
+            if (run == 0) {
+                world.renderFrame(frame);
+                sink += drawFrame(frame);
+                expected.push_back(frameHash(frame));
+            }
+            if (status != GWSTATUS_CONTINUE_GAME) {
+                world.cleanUp();
+                if (world.isGameOver())
+                    break;
+                if (status == GWSTATUS_FINISHED_LEVEL)
+                    world.advanceToNextLevel();
+                world.init();
+                if (run == 0) {
+                    world.renderFrame(frame);
+                    sink += drawFrame(frame);
+                    expected.push_back(frameHash(frame));
+                }
+            }
+        }
+        seconds[run] = secondsBetween(start, Clock::now());
+        if (run == 1) {
+            done = true;
+            display.join();
+            published = render.published();
+        }
+    }
+    out << fixed << setprecision(2);
+    out << "us/tick drawing after each tick\t" << seconds[0] * 1e6 / played[0] << endl;
+    out << "us/tick drawing on a display thread\t" << seconds[1] * 1e6 / played[1] << "\t(" << (1 - seconds[1] / seconds[0]) * 100 << "% less, "
+        << thread::hardware_concurrency() << " hardware threads)" << endl;
+    out << "frames published\t" << published << "\tdrawn " << drawn << "\tskipped " << published - drawn << "\t(checksum " << (sink != 0) << ")" << endl;
+    bool identical = (published == (long long) expected.size() - 1 && torn == 0);
+    out << "drawn frames match the world\t" << (identical ? "yes" : "no") << endl;
+    return identical;
+}
+
+// Profile the phases of each tick while the bot plays regular levels
+// Writes the profile as JSON and, given a baseline profile, reports the phases that regressed past the tolerance
+int runProfile(int ticks, unsigned int seed, const string& baselineFile, double tolerance, const WorldConfig& config, ostream& out, ostream& report) {
+    StudentWorld world("", true);
+    BotInput bot(seed);
+    PhaseProfiler profiler;
+    setUpBotWorld(world, bot, seed, config);
+    world.setProfiler(&profiler);
+    playBotLevels(world, ticks, [&world](int) { return world.move(); }, []() {});
+
+    ostringstream json;
+    profiler.writeJson(json, "bot_level_seed_" + to_string(seed));
+    out << json.str();
+    if (baselineFile.empty())
+        return 0;
+    ifstream in(baselineFile);
+    if (!in) {
+        report << "cannot read baseline " << baselineFile << endl;
+        return -1;
+    }
+    ostringstream baseline;
+    baseline << in.rdbuf();
+    int regressions = compareWithBaseline(json.str(), baseline.str(), tolerance, report);
+    report << regressions << " phase(s) regressed by more than " << tolerance * 100 << "%" << endl;
+    return regressions;
+}
+
+// Count the allocations of each tick while the bot plays regular levels
+// A tick after the warmup is steady when no actor is created and the level holds no more actors than it already has
+// at some point before. Steady ticks should not allocate at all: with assertNoAllocation every one that does is
+// reported and counted as a failure
+int runAllocationReport(int ticks, double warmupFraction, unsigned int seed, bool assertNoAllocation, const WorldConfig& config, ostream& out) {
+    if (!allocationTrackingEnabled()) {
+        out << "built without -DTRACK_ALLOCATIONS, no allocations are counted" << endl;
+        return assertNoAllocation ? 1 : 0;
+    }
+    int warmupTicks = (int) (ticks * warmupFraction);
+    StudentWorld world("", true);
+    BotInput bot(seed);
+    setUpBotWorld(world, bot, seed, config);
+
+    AllocationStats totals = allocationStats();
+    for (int i = 0; i < NUMBER_OF_ALLOCATION_CATEGORIES; i++)
+        totals.allocations[i] = totals.bytes[i] = 0;
+    int mostActors = 0;
+    int steadyTicks = 0;
+    int failures = 0;
+    resetPeakLiveBytes();
+    auto playTick = [&](int tick) {
+        int actors = world.numberOfActors();
+        AllocationStats before = allocationStats();
+        int status = world.move();
+        AllocationStats after = allocationStats();
+
+        long long allocations = after.totalAllocations() - before.totalAllocations();
+        for (int i = 0; i < NUMBER_OF_ALLOCATION_CATEGORIES; i++) {
+            totals.allocations[i] += after.allocations[i] - before.allocations[i];
+            totals.bytes[i] += after.bytes[i] - before.bytes[i];
+        }
+        bool steady = tick > warmupTicks && status == GWSTATUS_CONTINUE_GAME && actors <= mostActors && after.allocations[ALLOC_ACTORS] == before.allocations[ALLOC_ACTORS];
+        mostActors = max(mostActors, actors);
+        if (steady) {
+            steadyTicks++;
+            if (allocations > 0 && assertNoAllocation) {
+                failures++;
+                out << "steady tick " << tick << " allocated:";
+                for (int i = 0; i < NUMBER_OF_ALLOCATION_CATEGORIES; i++) {
+                    if (after.allocations[i] != before.allocations[i])
+                        out << " " << allocationCategoryName(i) << " " << after.allocations[i] - before.allocations[i] << " (" << after.bytes[i] - before.bytes[i] << " bytes)";
+                }
+                out << endl;
+            }
+        }
+        return status;
+    };
+    int played = playBotLevels(world, ticks, playTick, [&]() { mostActors = world.numberOfActors(); });
+
+    out << fixed << setprecision(2);
+    out << "category	allocations/tick	bytes/tick" << endl;
+    for (int i = 0; i < NUMBER_OF_ALLOCATION_CATEGORIES; i++)
+        out << allocationCategoryName(i) << '\t' << (double) totals.allocations[i] / played << '\t' << (double) totals.bytes[i] / played << endl;
+    out << "peak live bytes	" << allocationStats().peakLiveBytes << endl;
+    out << "steady ticks	" << steadyTicks << " of " << played << endl;
+    if (steadyTicks == 0) {
+        out << "no steady tick to check, play more ticks" << endl;
+        return assertNoAllocation ? -1 : 0;
+    }
+    if (assertNoAllocation)
+        out << (failures == 0 ? "no steady tick allocated" : to_string(failures) + " steady tick(s) allocated") << endl;
+    return failures;
+}
+
+// Record telemetry while the bot plays regular levels
+// Reports how many records reached the file and how many were dropped, along with the cost of a tick with recording on
+int runTelemetry(int ticks, unsigned int seed, const string& path, int ringCapacity, const WorldConfig& config, ostream& out) {
+    TelemetryWriter telemetry(ringCapacity);
+    if (!telemetry.open(path)) {
+        out << "cannot write " << path << endl;
+        return -1;
+    }
+    StudentWorld world("", true);
+    BotInput bot(seed);
+    setUpBotWorld(world, bot, seed, config);
+    world.setTelemetry(&telemetry);
+    double totalSeconds = 0;
+    double maxSeconds = 0;
+    auto playTick = [&](int) {
+        Clock::time_point start = Clock::now();
+        int status = world.move();
+        double seconds = secondsBetween(start, Clock::now());
+        totalSeconds += seconds;
+        maxSeconds = max(maxSeconds, seconds);
+        return status;
+    };
+    int played = playBotLevels(world, ticks, playTick, []() {});
+    telemetry.close();
+
+    out << fixed << setprecision(1);
+    out << "ticks\t" << played << endl;
+    out << "ring capacity\t" << ringCapacity << endl;
+    out << "records written\t" << telemetry.written() << endl;
+    out << "records dropped\t" << telemetry.dropped() << endl;
+    out << "us/tick\t" << totalSeconds * 1e6 / played << endl;
+    out << "max us/tick\t" << maxSeconds * 1e6 << endl;
+    return (int) telemetry.dropped();
+}
+
+// Profile the spatial queries while the bot plays regular levels
+// Reports the statistics of each call site along with the cost of a tick with profiling on, and writes the heatmaps
+bool runQueryProfile(int ticks, unsigned int seed, const string& path, const WorldConfig& config, ostream& out) {
+    ofstream file(path);
+    if (!file) {
+        out << "cannot write " << path << endl;
+        return false;
+    }
+    QueryProfiler profiler;
+    StudentWorld world("", true);
+    BotInput bot(seed);
+    setUpBotWorld(world, bot, seed, config);
+    world.setQueryProfiler(&profiler);
+    double totalSeconds = 0;
+    auto playTick = [&](int) {
+        Clock::time_point start = Clock::now();
+        int status = world.move();
+        totalSeconds += secondsBetween(start, Clock::now());
+        return status;
+    };
+    int played = playBotLevels(world, ticks, playTick, []() {});
+    profiler.writeHeatmaps(file);
+    file.close();
+
+    profiler.writeSummary(out);
+    out << fixed << setprecision(1);
+    out << "heatmap frames	" << profiler.frames().size() << endl;
+    out << "us/tick	" << totalSeconds * 1e6 / played << endl;
+    return !file.fail();
+}
+
+// Time the overlap queries and each bacterium's final action in a mixed dish
+void runMicrobenchmarks(ostream& out) {
+    const int population = 1000;
+    const int rounds = 20;
+
+    StudentWorld world("", true);
+    world.seedRandom(1);
+    world.initEmptyDish();
+    addFood(world, population / 4);
+    populateProjectiles(world, population / 4);
+    addBacteria(world, ID_REGULAR_SALMONELLA, population / 4);
+
+    vector<Bacteria*> regular;
+    vector<Bacteria*> aggressive;
+    vector<Bacteria*> ecoli;
+    double x;
+    double y;
+    for (int i = 0; i < 100; i++) {
+        randomPointInDish(world, x, y, world.worldConfig().placementRadius - 10);
+        regular.push_back(new RegularSalmonella(&world, x, y));
+        aggressive.push_back(new AggressiveSalmonella(&world, x, y));
+        ecoli.push_back(new Ecoli(&world, x, y));
+        world.addActor(regular.back());
+        world.addActor(aggressive.back());
+        world.addActor(ecoli.back());
+    }
+
+    // The query centers are a sample of the actors of the dish
+    vector<Actor*> centers;
+    centers.insert(centers.end(), regular.begin(), regular.end());
+    centers.insert(centers.end(), ecoli.begin(), ecoli.end());
+
+    out << "microbenchmark\tcalls\tns/call\tmean results" << endl;
+    out << fixed << setprecision(1);
+
+    // isOverlap between every pair of sampled actors
+    long long calls = 0;
+    long long hits = 0;
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < centers.size(); i++) {
+            for (size_t j = 0; j < centers.size(); j++) {
+                if (world.isOverlap(centers[i], centers[j], SPRITE_WIDTH))
+                    hits++;
+                calls++;
+            }
+        }
+    }
+    double seconds = secondsBetween(start, Clock::now());
+    out << "isOverlap\t" << calls << '\t' << seconds * 1e9 / calls << '\t' << (double) hits / calls << endl;
+
+    // getOverlap for every radius the game queries with
+    const double radii[] = { SPRITE_WIDTH/2, SPRITE_WIDTH, 2*SPRITE_RADIUS, VIEW_RADIUS*2 };
+    const char* radiusNames[] = { "SPRITE_WIDTH/2", "SPRITE_WIDTH", "2*SPRITE_RADIUS", "VIEW_RADIUS*2" };
+    for (int k = 0; k < 4; k++) {
+        calls = 0;
+        long long results = 0;
+        start = Clock::now();
+        for (int r = 0; r < rounds; r++) {
+            for (size_t i = 0; i < centers.size(); i++) {
+                list<Actor*> overlaps;
+                world.getOverlap(centers[i], overlaps, radii[k]);
+                results += overlaps.size();
+                calls++;
+            }
+        }
+        seconds = secondsBetween(start, Clock::now());
+        out << "getOverlap(" << radiusNames[k] << ")\t" << calls << '\t' << seconds * 1e9 / calls << '\t' << (double) results / calls << endl;
+    }
+
+    // The same overlaps visited without a list, then only whether any bacterium overlaps
+    calls = 0;
+    long long visited = 0;
+    start = Clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < centers.size(); i++) {
+            world.forEachOverlap(centers[i], MASK_ALL_TYPES, SPRITE_WIDTH, [&visited](Actor*) {
+                visited++;
+                return true;
+            });
+            calls++;
+        }
+    }
+    seconds = secondsBetween(start, Clock::now());
+    out << "forEachOverlap(SPRITE_WIDTH)\t" << calls << '\t' << seconds * 1e9 / calls << '\t' << (double) visited / calls << endl;
+
+    calls = 0;
+    hits = 0;
+    start = Clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < centers.size(); i++) {
+            if (world.anyOverlap(centers[i], MASK_BACTERIA, SPRITE_WIDTH))
+                hits++;
+            calls++;
+        }
+    }
+    seconds = secondsBetween(start, Clock::now());
+    out << "anyOverlap(bacteria)\t" << calls << '\t' << seconds * 1e9 / calls << '\t' << (double) hits / calls << endl;
+
+    // finalAction of each kind of bacterium
+    vector<Bacteria*>* kinds[] = { &regular, &aggressive, &ecoli };
+    const char* kindNames[] = { "RegularSalmonella", "AggressiveSalmonella", "Ecoli" };
+    for (int k = 0; k < 3; k++) {
+        calls = 0;
+        start = Clock::now();
+        for (int r = 0; r < rounds; r++) {
+            for (size_t i = 0; i < kinds[k]->size(); i++) {
+                (*kinds[k])[i]->finalAction();
+                calls++;
+            }
+        }
+        seconds = secondsBetween(start, Clock::now());
+        out << "finalAction(" << kindNames[k] << ")\t" << calls << '\t' << seconds * 1e9 / calls << '\t' << endl;
+    }
+
+    // rasterizeWorld of the whole dish, the result is the weight of all planes and must match the active actors, the
+    // player included
+    int activeActors = (world.player() != nullptr && world.player()->isActive()) ? 1 : 0;
+    const vector<ActorRecord>& records = world.records();
+    for (size_t i = 0; i < records.size(); i++) {
+        if (records[i].flags & FLAG_ACTIVE)
+            activeActors++;
+    }
+    for (int resolution = 64; resolution <= 128; resolution *= 2) {
+        for (int falloff = 0; falloff <= 1; falloff++) {
+            vector<float> planes(occupancyGridSize(resolution));
+            calls = 0;
+            double weight = 0;
+            start = Clock::now();
+            for (int r = 0; r < rounds * 10; r++) {
+                rasterizeWorld(world, resolution, falloff == 1, planes.data());
+                calls++;
+            }
+            seconds = secondsBetween(start, Clock::now());
+            for (size_t i = 0; i < planes.size(); i++)
+                weight += planes[i];
+            out << "rasterizeWorld(" << resolution << (falloff ? ", falloff" : "") << ")\t" << calls << '\t' << seconds * 1e9 / calls << '\t' << weight;
+            if (fabs(weight - activeActors) > 0.5)
+                out << "\tweight does not match the " << activeActors << " active actors";
+            out << endl;
+        }
+    }
+}
+
+/*---------------------*/
+/*-----Differential----*/
+/*---------------------*/
+
+namespace {
+
+// Rewind history each side of a differential run records, the changes of every tick are compared as they are made
+const size_t DIFFERENTIAL_REWIND_BUDGET = 4 << 20;
+
+// Set up a headless world for one side of a differential run, played by the bot and recording a rewind history
+void setUpWorld(StudentWorld& world, BotInput& bot, RewindBuffer& rewind, int engine, const Scenario* scenario, int n, unsigned int seed, const WorldConfig& config) {
+    world.setEngine(engine);
+    world.seedRandom(seed);
+    world.setWorldConfig(config);
+    world.setInputSource(&bot);
+    world.setRewind(&rewind);
+    if (scenario == nullptr)
+        world.init();
+    else {
+        world.initEmptyDish();
+        scenario->populate(world, n);
+    }
+}
+
+// Fill in a divergence for one field
+template <typename T>
+Divergence makeDivergence(int tick, int actorId, int objectType, const string& field, const T& reference, const T& optimized) {
+    Divergence divergence;
+    ostringstream referenceText;
+    ostringstream optimizedText;
+    referenceText << setprecision(17) << reference;
+    optimizedText << setprecision(17) << optimized;
+    divergence.found = true;
+    divergence.tick = tick;
+    divergence.actorId = actorId;
+    divergence.objectType = objectType;
+    divergence.field = field;
+    divergence.reference = referenceText.str();
+    divergence.optimized = optimizedText.str();
+    return divergence;
+}
+
+// Locate the first field that differs between two worlds whose state hashes differ
+Divergence findDivergence(const StudentWorld& reference, const StudentWorld& optimized, int tick) {
+    if (reference.getScore() != optimized.getScore())
+        return makeDivergence(tick, -1, -1, "score", reference.getScore(), optimized.getScore());
+    if (reference.getLives() != optimized.getLives())
+        return makeDivergence(tick, -1, -1, "lives", reference.getLives(), optimized.getLives());
+    if (reference.pits() != optimized.pits())
+        return makeDivergence(tick, -1, -1, "pits", reference.pits(), optimized.pits());
+
+    vector<ActorState> referenceStates;
+    vector<ActorState> optimizedStates;
+    reference.getState(referenceStates);
+    optimized.getState(optimizedStates);
+
+    size_t common = min(referenceStates.size(), optimizedStates.size());
+    for (size_t i = 0; i < common; i++) {
+        const ActorState& r = referenceStates[i];
+        const ActorState& o = optimizedStates[i];
+        if (r.id != o.id) {
+            // An actor only exists in one of the worlds
+            if (r.id < o.id)
+                return makeDivergence(tick, r.id, r.objectType, "exists", string("yes"), string("no"));
+            return makeDivergence(tick, o.id, o.objectType, "exists", string("no"), string("yes"));
+        }
+        if (r.objectType != o.objectType)
+            return makeDivergence(tick, r.id, r.objectType, "objectType", r.objectType, o.objectType);
+        if (r.x != o.x)
+            return makeDivergence(tick, r.id, r.objectType, "x", r.x, o.x);
+        if (r.y != o.y)
+            return makeDivergence(tick, r.id, r.objectType, "y", r.y, o.y);
+        if (r.direction != o.direction)
+            return makeDivergence(tick, r.id, r.objectType, "direction", r.direction, o.direction);
+        if (r.active != o.active)
+            return makeDivergence(tick, r.id, r.objectType, "active", r.active, o.active);
+        if (r.hitPoints != o.hitPoints)
+            return makeDivergence(tick, r.id, r.objectType, "hitPoints", r.hitPoints, o.hitPoints);
+        for (int k = 0; k < ActorState::NUMBER_OF_COUNTERS; k++) {
+            if (r.counters[k] != o.counters[k])
+                return makeDivergence(tick, r.id, r.objectType, r.counterName(k), r.counters[k], o.counters[k]);
+        }
+    }
+    if (referenceStates.size() > common)
+        return makeDivergence(tick, referenceStates[common].id, referenceStates[common].objectType, "exists", string("yes"), string("no"));
+    if (optimizedStates.size() > common)
+        return makeDivergence(tick, optimizedStates[common].id, optimizedStates[common].objectType, "exists", string("no"), string("yes"));
+
+    // Only the level or tick count can be left
+    return makeDivergence(tick, -1, -1, "level/tick", reference.getLevel() * 100000 + reference.ticks(), optimized.getLevel() * 100000 + optimized.ticks());
+}
+
+// Locate the first change recorded for a tick that differs between the rewind histories of two worlds, found is false
+// if there is none
+Divergence findHistoryDivergence(const RewindBuffer& reference, const RewindBuffer& optimized, int tick) {
+    vector<RewindDelta> referenceChanges;
+    vector<RewindDelta> optimizedChanges;
+    Divergence none;
+    none.found = false;
+    if (reference.changesAt(tick, referenceChanges) != optimized.changesAt(tick, optimizedChanges))
+        return makeDivergence(tick, -1, -1, "history recorded", string("yes"), string("no"));
+
+    size_t common = min(referenceChanges.size(), optimizedChanges.size());
+    for (size_t i = 0; i < common; i++) {
+        const RewindDelta& r = referenceChanges[i];
+        const RewindDelta& o = optimizedChanges[i];
+        if (r.id != o.id) {
+            // A change only one of the histories recorded
+            if (r.id < o.id)
+                return makeDivergence(tick, r.id, r.objectType, "history changes", r.changes, 0);
+            return makeDivergence(tick, o.id, o.objectType, "history changes", 0, o.changes);
+        }
+        if (r.objectType != o.objectType)
+            return makeDivergence(tick, r.id, r.objectType, "history objectType", r.objectType, o.objectType);
+        if (r.changes != o.changes)
+            return makeDivergence(tick, r.id, r.objectType, "history changes", r.changes, o.changes);
+        if (r.x != o.x)
+            return makeDivergence(tick, r.id, r.objectType, "history x", r.x, o.x);
+        if (r.y != o.y)
+            return makeDivergence(tick, r.id, r.objectType, "history y", r.y, o.y);
+        if (r.hitPoints != o.hitPoints)
+            return makeDivergence(tick, r.id, r.objectType, "history hitPoints", r.hitPoints, o.hitPoints);
+    }
+    if (referenceChanges.size() > common)
+        return makeDivergence(tick, referenceChanges[common].id, referenceChanges[common].objectType, "history changes", referenceChanges[common].changes, 0);
+    if (optimizedChanges.size() > common)
+        return makeDivergence(tick, optimizedChanges[common].id, optimizedChanges[common].objectType, "history changes", 0, optimizedChanges[common].changes);
+    return none;
+}
+
+}
+
+// Play both engines tick by tick and stop at the first tick where their states or the changes their rewind histories
+// recorded differ
+Divergence runDifferential(const Scenario* scenario, int n, unsigned int seed, int maxTicks, const WorldConfig& config) {
+    StudentWorld reference("", true);
+    StudentWorld optimized("", true);
+    BotInput referenceBot(seed);
+    BotInput optimizedBot(seed);
+    RewindBuffer referenceRewind(DIFFERENTIAL_REWIND_BUDGET);
+    RewindBuffer optimizedRewind(DIFFERENTIAL_REWIND_BUDGET);
+    setUpWorld(reference, referenceBot, referenceRewind, ENGINE_REFERENCE, scenario, n, seed, config);
+    setUpWorld(optimized, optimizedBot, optimizedRewind, ENGINE_OPTIMIZED, scenario, n, seed, config);
+
+    for (int tick = 0; tick <= maxTicks; tick++) {
+        if (tick > 0) {
+            int referenceStatus = reference.move();
+            int optimizedStatus = optimized.move();
+            if (referenceStatus != optimizedStatus)
+                return makeDivergence(tick, -1, -1, "status", referenceStatus, optimizedStatus);
+            if (referenceStatus != GWSTATUS_CONTINUE_GAME)
+                break;
+        }
+        if (reference.stateHash() != optimized.stateHash())
+            return findDivergence(reference, optimized, tick);
+        if (tick > 0) {
+            Divergence history = findHistoryDivergence(referenceRewind, optimizedRewind, reference.ticks());
+            if (history.found)
+                return history;
+        }
+    }
+
+    Divergence none;
+    none.found = false;
+    none.tick = maxTicks;
+    none.actorId = -1;
+    none.objectType = -1;
+    return none;
+}
+
+// Run the differential test on a regular level and on every benchmark scenario
+void runDifferentialSuite(int n, unsigned int seed, int maxTicks, const WorldConfig& config, ostream& out) {
+    const vector<Scenario>& scenarios = benchmarkScenarios();
+    for (int i = -1; i < (int) scenarios.size(); i++) {
+        const Scenario* scenario = (i < 0) ? nullptr : &scenarios[i];
+        Divergence divergence = runDifferential(scenario, n, seed, maxTicks, config);
+        out << (scenario == nullptr ? "level" : scenario->name) << ": ";
+        if (!divergence.found)
+            out << "identical" << endl;
+        else {
+            out << "diverged at tick " << divergence.tick;
+            if (divergence.actorId >= 0)
+                out << ", actor " << divergence.actorId << " (type " << divergence.objectType << ")";
+            out << ", field " << divergence.field << ": reference " << divergence.reference << ", optimized " << divergence.optimized << endl;
+        }
+    }
+}
+
+#ifdef BENCHMARK_MAIN
+
+// Parse a comma separated list of sizes
+vector<int> parseSizes(const string& text) {
+    vector<int> sizes;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find(',', start);
+        if (end == string::npos)
+            end = text.size();
+        sizes.push_back(atoi(text.substr(start, end - start).c_str()));
+        start = end + 1;
+    }
+    return sizes;
+}
+
+// Usage: Benchmark [--sizes 10,100,1000,10000] [--ticks 50] [--budget 2.0] [--seed 1] [--lod] [--ai-budget 0] [--bot]
+//                  [--config FILE] [--scale AREA] [--pregenerate] [--telemetry FILE [--ring 4096]] [--queries FILE]
+//                  [--micro | --diff | --soak LEVELS | --fork BRANCHES | --vector WORLDS | --locality | --fast-forward TICKS | --rewind TICKS | --render | --profile [--baseline FILE] [--tolerance 0.1]
+//                   | --alloc [--assert-no-alloc]]
+int main(int argc, char* argv[]) {
+    vector<int> sizes = { 10, 100, 1000, 10000 };
+    BenchmarkOptions options;
+    unsigned int seed = 1;
+    bool micro = false;
+    bool diff = false;
+    int soakLevels = 0;
+    int forkBranches = 0;
+    int vectorWorlds = 0;
+    bool locality = false;
+    int fastForwardBatch = 0;
+    int rewindTicks = 0;
+    bool render = false;
+    bool profile = false;
+    string baselineFile;
+    double tolerance = 0.1;
+    bool allocations = false;
+    bool assertNoAllocation = false;
+    string configFile;
+    double areaScale = 1;
+    string telemetryFile;
+    int ringCapacity = 4096;
+    string queriesFile;
+    bool pregenerateLevels = false;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc)
+            sizes = parseSizes(argv[++i]);
+        else if (arg == "--ticks" && i + 1 < argc)
+            options.maxTicks = atoi(argv[++i]);
+        else if (arg == "--budget" && i + 1 < argc)
+            options.timeBudgetSeconds = atof(argv[++i]);
+        else if (arg == "--lod")
+            options.aiLevelOfDetail = true;
+        else if (arg == "--ai-budget" && i + 1 < argc)
+            options.aiBudget = atoi(argv[++i]);
+        else if (arg == "--bot")
+            options.bot = true;
+        else if (arg == "--soak" && i + 1 < argc)
+            soakLevels = atoi(argv[++i]);
+        else if (arg == "--fork" && i + 1 < argc)
+            forkBranches = atoi(argv[++i]);
+        else if (arg == "--vector" && i + 1 < argc)
+            vectorWorlds = atoi(argv[++i]);
+        else if (arg == "--locality")
+            locality = true;
+        else if (arg == "--fast-forward" && i + 1 < argc)
+            fastForwardBatch = atoi(argv[++i]);
+        else if (arg == "--rewind" && i + 1 < argc)
+            rewindTicks = atoi(argv[++i]);
+        else if (arg == "--render")
+            render = true;
+        else if (arg == "--profile")
+            profile = true;
+        else if (arg == "--baseline" && i + 1 < argc)
+            baselineFile = argv[++i];
+        else if (arg == "--tolerance" && i + 1 < argc)
+            tolerance = atof(argv[++i]);
+        else if (arg == "--alloc")
+            allocations = true;
+        else if (arg == "--assert-no-alloc")
+            assertNoAllocation = true;
+        else if (arg == "--pregenerate")
+            pregenerateLevels = true;
+        else if (arg == "--telemetry" && i + 1 < argc)
+            telemetryFile = argv[++i];
+        else if (arg == "--ring" && i + 1 < argc)
+            ringCapacity = atoi(argv[++i]);
+        else if (arg == "--queries" && i + 1 < argc)
+            queriesFile = argv[++i];
+        else if (arg == "--config" && i + 1 < argc)
+            configFile = argv[++i];
+        else if (arg == "--scale" && i + 1 < argc)
+            areaScale = atof(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc)
+            seed = (unsigned int) atoi(argv[++i]);
+        else if (arg == "--micro")
+            micro = true;
+        else if (arg == "--diff")
+            diff = true;
+        else {
+            cerr << "Usage: " << argv[0] << " [--sizes 10,100,1000] [--ticks 50] [--budget 2.0] [--seed 1] [--lod] [--ai-budget 0] [--bot] [--config FILE] [--scale AREA] [--pregenerate] [--telemetry FILE [--ring 4096]] [--queries FILE] [--micro | --diff | --soak LEVELS | --fork BRANCHES | --vector WORLDS | --locality | --fast-forward TICKS | --rewind TICKS | --render | --profile [--baseline FILE] [--tolerance 0.1] | --alloc [--assert-no-alloc]]" << endl;
+            return 1;
+        }
+    }
+
+    // The dish of every run: the original one, or one read from a file, either of them optionally scaled up
+    if (!configFile.empty()) {
+        string error;
+        if (!loadWorldConfig(configFile, options.worldConfig, error)) {
+            cerr << configFile << ": " << error << endl;
+            return 1;
+        }
+    }
+    if (areaScale <= 0) {
+        cerr << "--scale must be positive" << endl;
+        return 1;
+    }
+    if (areaScale != 1)
+        options.worldConfig = scaledWorldConfig(options.worldConfig, areaScale);
+
+    if (!telemetryFile.empty())
+        return (runTelemetry(options.maxTicks, seed, telemetryFile, ringCapacity, options.worldConfig, cout) >= 0) ? 0 : 1;
+    if (!queriesFile.empty())
+        return runQueryProfile(options.maxTicks, seed, queriesFile, options.worldConfig, cout) ? 0 : 1;
+    if (allocations)
+        return (runAllocationReport(options.maxTicks, 0.1, seed, assertNoAllocation, options.worldConfig, cout) == 0) ? 0 : 3;
+    if (profile)
+        return (runProfile(options.maxTicks, seed, baselineFile, tolerance, options.worldConfig, cout, cerr) == 0) ? 0 : 2;
+    if (vectorWorlds > 0)
+        return runVectorBenchmark(vectorWorlds, options.maxTicks, seed, options.worldConfig, cout) ? 0 : 4;
+    if (locality)
+        return runLocalityBenchmark(options.maxTicks, seed, options.worldConfig, cout) ? 0 : 5;
+    if (rewindTicks > 0)
+        return runRewindBenchmark(options.maxTicks, rewindTicks, seed, options.worldConfig, cout) ? 0 : 7;
+    if (render)
+        return runRenderBenchmark(options.maxTicks, seed, options.worldConfig, cout) ? 0 : 8;
+    if (fastForwardBatch > 0)
+        return runFastForwardBenchmark(options.maxTicks, fastForwardBatch, seed, options.worldConfig, cout) ? 0 : 6;
+    if (micro)
+        runMicrobenchmarks(cout);
+    else if (forkBranches > 0)
+        runForkBenchmark(forkBranches, options.maxTicks, seed, options.worldConfig, cout);
+    else if (soakLevels > 0)
+        runSoak(soakLevels, 20000, seed, options.worldConfig, pregenerateLevels, cout);
+    else if (diff)
+        runDifferentialSuite(sizes.empty() ? 100 : sizes[0], seed, options.maxTicks, options.worldConfig, cout);
+    else
+        runScenarioSweep(sizes, options, cout);
+    return 0;
+}
+
+#endif // BENCHMARK_MAIN
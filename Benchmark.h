@@ -0,0 +1,108 @@
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include "WorldConfig.h"
+
+// Headless benchmark suite for the simulation core
+// Build it together with the framework sources (minus main.cpp) and -DBENCHMARK_MAIN, plus -DTRACK_ALLOCATIONS for --alloc
+
+class StudentWorld;
+
+// A scenario fills an empty headless dish with a workload of size n
+struct Scenario {
+    std::string name;
+    void (*populate)(StudentWorld& world, int n);
+    void (*refresh)(StudentWorld& world, int n);    // Tops the workload back up between ticks, may be nullptr
+};
+
+// How each scenario run is played
+struct BenchmarkOptions {
+    int maxTicks;
+    double timeBudgetSeconds;
+    bool aiLevelOfDetail;                           // Run with the world's default AI level of detail bands
+    int aiBudget;                                   // AI budget per tick when level of detail is on, 0 for no limit
+    bool bot;                                       // Let the scripted bot play instead of leaving the player idle
+    WorldConfig worldConfig;                        // Dish the scenarios are played in
+    BenchmarkOptions();
+};
+
+// The measured cost of one scenario at one size
+struct ScenarioResult {
+    std::string scenario;
+    int n;
+    int actors;
+    int ticks;
+    double microsecondsPerTick;
+    double nanosecondsPerActorTick;
+    int status;                                     // GWSTATUS_CONTINUE_GAME unless the run ended early
+};
+
+// The first point at which the optimized engine stopped matching the reference engine
+struct Divergence {
+    bool found;
+    int tick;
+    int actorId;                                    // -1 when a field of the world itself differs
+    int objectType;
+    std::string field;
+    std::string reference;
+    std::string optimized;
+};
+
+const std::vector<Scenario>& benchmarkScenarios();
+ScenarioResult runScenario(const Scenario& scenario, int n, const BenchmarkOptions& options);
+void runScenarioSweep(const std::vector<int>& sizes, const BenchmarkOptions& options, std::ostream& out);
+void runMicrobenchmarks(std::ostream& out);
+void reportActorLayout(std::ostream& out);
+
+// Soak run: the bot plays real levels, one line of results per level, optionally laying out levels in the background
+void runSoak(int maxLevels, int maxTicksPerLevel, unsigned int seed, const WorldConfig& config, bool pregenerateLevels, std::ostream& out);
+
+// Per phase profile of a bot playing regular levels, as JSON, optionally compared with a baseline profile
+// Returns the number of phases that regressed, or -1 if the baseline could not be read
+int runProfile(int ticks, unsigned int seed, const std::string& baselineFile, double tolerance, const WorldConfig& config, std::ostream& out, std::ostream& report);
+
+// Allocations per tick and category of a bot playing regular levels, needs a -DTRACK_ALLOCATIONS build
+// The first warmupFraction of the ticks are never steady. Returns the number of steady ticks that allocated when
+// assertNoAllocation is set, or -1 if it is set and no tick was steady
+int runAllocationReport(int ticks, double warmupFraction, unsigned int seed, bool assertNoAllocation, const WorldConfig& config, std::ostream& out);
+
+// Per tick telemetry of a bot playing regular levels, written to a file through a ring of the given capacity
+// Returns the number of records dropped because the ring was full, or -1 if the file could not be written
+int runTelemetry(int ticks, unsigned int seed, const std::string& path, int ringCapacity, const WorldConfig& config, std::ostream& out);
+
+// Statistics of the spatial queries of a bot playing regular levels by call site, with heatmaps of the query and actor
+// density written to a file as CSV. Returns false if the file could not be written
+bool runQueryProfile(int ticks, unsigned int seed, const std::string& path, const WorldConfig& config, std::ostream& out);
+
+// Fork cost, fork fidelity and look-ahead branches played serially and in parallel
+void runForkBenchmark(int branches, int depth, unsigned int seed, const WorldConfig& config, std::ostream& out);
+
+// Steps per second of a vector environment taking random actions, on one thread and on the whole pool
+// Returns false if the two runs did not observe the same worlds
+bool runVectorBenchmark(int worlds, int steps, unsigned int seed, const WorldConfig& config, std::ostream& out);
+
+// Tick cost of a bot playing regular levels with the records in list order and then kept in Morton order, with cache
+// misses per tick where the hardware counters can be read. Returns false if the two runs did not play the same game
+bool runLocalityBenchmark(int ticks, unsigned int seed, const WorldConfig& config, std::ostream& out);
+
+// Regular levels played tick by tick and then fast-forwarded the given number of ticks at a time, by an idle player and
+// by the bot. Returns false if fast-forward played a different game
+bool runFastForwardBenchmark(int ticks, int ticksPerBatch, unsigned int seed, const WorldConfig& config, std::ostream& out);
+
+// Tick cost of the bot playing regular levels with and without a rewind history, and the time to rewind a number of
+// ticks every so often. Returns false if a rewound world was not the world as it had been
+bool runRewindBenchmark(int ticks, int rewindTicks, unsigned int seed, const WorldConfig& config, std::ostream& out);
+
+// Tick cost of the bot playing regular levels with each tick's frame drawn right after it, and with the frames drawn by
+// a display thread while the next ticks run. Returns false if a frame the display drew was not the one the world wrote
+bool runRenderBenchmark(int ticks, unsigned int seed, const WorldConfig& config, std::ostream& out);
+
+// Differential testing: play the reference and optimized engines side by side from the same seed
+// A null scenario plays a regular level built by init
+Divergence runDifferential(const Scenario* scenario, int n, unsigned int seed, int maxTicks, const WorldConfig& config);
+void runDifferentialSuite(int n, unsigned int seed, int maxTicks, const WorldConfig& config, std::ostream& out);
+
+#endif // BENCHMARK_H_
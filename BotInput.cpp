@@ -0,0 +1,93 @@
+#include "BotInput.h"
+#include "Actor.h"
+#include "GameConstants.h"
+#include <math.h>
+using namespace std;
+
+// Bacteria within this distance of the player count towards it being surrounded
+const double BOT_SURROUNDED_RADIUS = 48;
+const int BOT_SURROUNDED_COUNT = 4;
+
+// A spray starts 2*SPRITE_RADIUS out and travels 112 units
+const double BOT_SPRAY_RANGE = 2*SPRITE_RADIUS + 112;
+
+// Sprays the bot waits for once it has run out
+const int BOT_RECHARGED_SPRAYS = 10;
+
+// Constructor
+BotInput::BotInput(unsigned int seed)
+    : m_random(seed), m_patrolKey(KEY_PRESS_LEFT), m_patrolTicks(0), m_recharging(false)
+{}
+
+// Pick the key for this tick
+bool BotInput::getKey(StudentWorld& world, int& value) {
+    Socrates* player = world.player();
+    double playerX = player->getX();
+    double playerY = player->getY();
+
+    // Find the nearest bacterium and count the ones that are close, from the compact records
+    const vector<ActorRecord>& records = world.records();
+    const ActorRecord* nearest = nullptr;
+    double nearestDistanceSquared = 0;
+    int close = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+        const ActorRecord& record = records[i];
+        if (!(record.flags & FLAG_ACTIVE) || !hasType(MASK_BACTERIA, record.flags & FLAG_TYPE_MASK))
+            continue;
+        double dx = record.x - playerX;
+        double dy = record.y - playerY;
+        double distanceSquared = dx*dx + dy*dy;
+        if (distanceSquared <= BOT_SURROUNDED_RADIUS * BOT_SURROUNDED_RADIUS)
+            close++;
+        // Ties go to the lowest id, whatever order the records are in
+        if (nearest == nullptr || distanceSquared < nearestDistanceSquared || (distanceSquared == nearestDistanceSquared && record.id < nearest->id)) {
+            nearest = &record;
+            nearestDistanceSquared = distanceSquared;
+        }
+    }
+
+    // Surrounded: burn everything around the player
+    if (close >= BOT_SURROUNDED_COUNT && player->ftCharges() > 0) {
+        value = KEY_PRESS_ENTER;
+        return true;
+    }
+
+    // Sprays only come back on ticks without input
+    if (player->sprays() == 0)
+        m_recharging = true;
+    else if (player->sprays() >= BOT_RECHARGED_SPRAYS)
+        m_recharging = false;
+    if (m_recharging)
+        return false;
+
+    if (nearest != nullptr) {
+        // Compare the bearing to the bacterium with the direction the player faces
+        double bearing = atan2(nearest->y - playerY, nearest->x - playerX) * 180 / M_PI;
+        double difference = fmod(bearing - player->getDirection() + 540.0, 360.0) - 180;
+        double distanceToNearest = sqrt(nearestDistanceSquared);
+        double tolerance = max(3.0, atan2(SPRITE_WIDTH, distanceToNearest) * 180 / M_PI);
+
+        if (fabs(difference) <= tolerance) {
+            if (distanceToNearest <= BOT_SPRAY_RANGE) {
+                value = KEY_PRESS_SPACE;
+                return true;
+            }
+        }
+        else {
+            // Moving counterclockwise turns the player's facing faster than the bearing to anything inside the dish
+            value = (difference < 0) ? KEY_PRESS_LEFT : KEY_PRESS_RIGHT;
+            return true;
+        }
+    }
+
+    // Nothing to aim at: circle the rim, every so often reconsidering the direction
+    if (m_patrolTicks <= 0) {
+        uniform_int_distribution<int> ticks(20, 120);
+        uniform_int_distribution<int> coin(0, 1);
+        m_patrolTicks = ticks(m_random);
+        m_patrolKey = coin(m_random) ? KEY_PRESS_LEFT : KEY_PRESS_RIGHT;
+    }
+    m_patrolTicks--;
+    value = m_patrolKey;
+    return true;
+}
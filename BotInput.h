@@ -0,0 +1,22 @@
+#ifndef BOTINPUT_H_
+#define BOTINPUT_H_
+
+#include "StudentWorld.h"
+#include <random>
+
+// Scripted player for automated soak and load runs
+// It circles the rim, sprays along the bearing of the nearest bacterium and uses flames when surrounded
+// Every decision depends only on the world and the seed, so runs are reproducible
+
+class BotInput : public InputSource {
+  public:
+    BotInput(unsigned int seed);
+    bool getKey(StudentWorld& world, int& value);
+  private:
+    mt19937 m_random;
+    int m_patrolKey;        // Direction to circle in while nothing is in range
+    int m_patrolTicks;      // Ticks left before the patrol direction is reconsidered
+    bool m_recharging;      // Out of sprays, holding still until they are mostly back
+};
+
+#endif // BOTINPUT_H_
@@ -0,0 +1,71 @@
+#include "LevelArena.h"
+#include "AllocationTracker.h"
+#include <algorithm>
+#include <new>
+using namespace std;
+
+// Every allocation is aligned as operator new would align it
+const size_t ARENA_ALIGNMENT = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+// Smallest block the arena allocates
+const size_t ARENA_MIN_BLOCK = 4096;
+
+// Constructor
+LevelArena::LevelArena(size_t capacity)
+    : m_blockSize(0), m_next(nullptr), m_end(nullptr), m_used(0)
+{
+    addBlock(capacity);
+}
+
+// Destructor
+LevelArena::~LevelArena() {
+    freeBlocks();
+}
+
+// Hand out the next size bytes, starting a new block twice as big as the last one when they do not fit
+void* LevelArena::allocate(size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    if ((size_t) (m_end - m_next) < size)
+        addBlock(max(size, 2 * m_blockSize));
+    void* pointer = m_next;
+    m_next += size;
+    m_used += size;
+    return pointer;
+}
+
+// Take back everything at once, merging the blocks into one if the level outgrew the first
+void LevelArena::reset(size_t capacity) {
+    capacity = max(capacity, ARENA_MIN_BLOCK);
+    if (m_blocks.size() == 1 && m_blockSize >= capacity)
+        m_next = m_blocks[0];
+    else {
+        freeBlocks();
+        addBlock(capacity);
+    }
+    m_used = 0;
+}
+
+// Return the bytes allocated since the last reset
+size_t LevelArena::used() const {
+    return m_used;
+}
+
+// Start allocating from a new block
+void LevelArena::addBlock(size_t size) {
+    size = max(size, ARENA_MIN_BLOCK);
+    char* block = static_cast<char*>(allocateInCategory(ALLOC_ACTORS, size));
+    m_blocks.push_back(block);
+    m_blockSize = size;
+    m_next = block;
+    m_end = block + size;
+}
+
+// Free every block
+void LevelArena::freeBlocks() {
+    for (size_t i = 0; i < m_blocks.size(); i++)
+        freeInCategory(m_blocks[i]);
+    m_blocks.clear();
+    m_blockSize = 0;
+    m_next = nullptr;
+    m_end = nullptr;
+}
@@ -0,0 +1,34 @@
+#ifndef LEVELARENA_H_
+#define LEVELARENA_H_
+
+#include <vector>
+#include <cstddef>
+
+// Monotonic memory for the actors that last a whole level: Socrates, pits, food and dirt
+// Allocating bumps a pointer and freeing does nothing, the memory of the whole level is taken back at once by reset.
+// The arena keeps one block as big as everything the last level needed, so a run of levels of about the same makeup
+// allocates no memory at all between levels
+class LevelArena {
+  public:
+    LevelArena(std::size_t capacity);
+    ~LevelArena();
+    void* allocate(std::size_t size);
+
+    // Take back everything allocated so far, keeping a single block of at least capacity bytes
+    void reset(std::size_t capacity);
+
+    // Bytes allocated since the last reset, the high-water mark of the level once it is set up
+    std::size_t used() const;
+  private:
+    std::vector<char*> m_blocks;
+    std::size_t m_blockSize;            // Size of the last block
+    char* m_next;
+    char* m_end;
+    std::size_t m_used;
+
+    // Helper Functions
+    void addBlock(std::size_t size);
+    void freeBlocks();
+};
+
+#endif // LEVELARENA_H_
@@ -0,0 +1,143 @@
+#include "OccupancyGrid.h"
+#include "Actor.h"
+#include <algorithm>
+using namespace std;
+
+namespace {
+
+// Channel of each object type, by ID
+const int TYPE_CHANNELS[] = {
+    CHANNEL_SOCRATES,                   // ID_SOCRATES
+    CHANNEL_REGULAR_SALMONELLA,         // ID_REGULAR_SALMONELLA
+    CHANNEL_AGGRESSIVE_SALMONELLA,      // ID_AGGRESSIVE_SALMONELLA
+    CHANNEL_ECOLI,                      // ID_ECOLI
+    CHANNEL_PIT,                        // ID_PIT
+    CHANNEL_PROJECTILES,                // ID_FLAME
+    CHANNEL_PROJECTILES,                // ID_SPRAY
+    CHANNEL_DIRT,                       // ID_DIRT
+    CHANNEL_FOOD,                       // ID_FOOD
+    CHANNEL_GOODIES,                    // ID_HEALTH_GOODIE
+    CHANNEL_GOODIES,                    // ID_FLAME_GOODIE
+    CHANNEL_GOODIES,                    // ID_LIFE_GOODIE
+    CHANNEL_FUNGUS,                     // ID_FUNGI
+};
+
+// Add a single actor to the plane of its channel, the same way the blocks of records are added
+void addActor(const StudentWorld& world, int resolution, bool falloff, int channel, double x, double y, float* planes) {
+    const float originX = (float) (world.dishCenterX() - world.dishRadius());
+    const float originY = (float) (world.dishCenterY() - world.dishRadius());
+    const float scale = (float) (resolution / (2 * world.dishRadius()));
+    const float offset = falloff ? 0.5f : 0.0f;
+    const float last = (float) (resolution - 1);
+    float gridX = min(max(((float) x - originX) * scale - offset, 0.0f), last);
+    float gridY = min(max(((float) y - originY) * scale - offset, 0.0f), last);
+    float* plane = planes + channel * resolution * resolution;
+    if (!falloff) {
+        plane[(int) gridY * resolution + (int) gridX] += 1;
+        return;
+    }
+    int column = min((int) gridX, max(resolution - 2, 0));
+    int row = min((int) gridY, max(resolution - 2, 0));
+    int next = (resolution > 1) ? 1 : 0;
+    float weightX = gridX - column;
+    float weightY = gridY - row;
+    plane += row * resolution + column;
+    plane[0] += (1 - weightX) * (1 - weightY);
+    plane[next] += weightX * (1 - weightY);
+    plane[next * resolution] += (1 - weightX) * weightY;
+    plane[next * resolution + next] += weightX * weightY;
+}
+
+}
+
+// Return the number of floats of a grid
+int occupancyGridSize(int resolution) {
+    return NUMBER_OF_CHANNELS * resolution * resolution;
+}
+
+// Overwrite planes with the actors of a world, one block of records at a time. The player has no record and is added on
+// its own
+void rasterizeWorld(const StudentWorld& world, int resolution, bool falloff, float* planes) {
+    const int cells = resolution * resolution;
+    fill(planes, planes + occupancyGridSize(resolution), 0.0f);
+    Socrates* player = world.player();
+    if (player != nullptr && player->isActive())
+        addActor(world, resolution, falloff, CHANNEL_SOCRATES, player->getX(), player->getY(), planes);
+
+    const float originX = (float) (world.dishCenterX() - world.dishRadius());
+    const float originY = (float) (world.dishCenterY() - world.dishRadius());
+    const float scale = (float) (resolution / (2 * world.dishRadius()));
+    // With falloff positions are measured from the centers of the cells
+    const float offset = falloff ? 0.5f : 0.0f;
+    const float last = (float) (resolution - 1);
+    // The second cell of a falloff pair, none on a grid one cell wide
+    const int lastFirst = max(resolution - 2, 0);
+    const int next = (resolution > 1) ? 1 : 0;
+
+    float x[RASTER_BLOCK];
+    float y[RASTER_BLOCK];
+    int channel[RASTER_BLOCK];
+    float weight[RASTER_BLOCK];
+    int cell[RASTER_BLOCK];
+    float weightX[RASTER_BLOCK];
+    float weightY[RASTER_BLOCK];
+
+    const vector<ActorRecord>& records = world.records();
+    for (size_t first = 0; first < records.size(); first += RASTER_BLOCK) {
+        const ActorRecord* block = &records[first];
+        int count = (int) min(records.size() - first, (size_t) RASTER_BLOCK);
+
+        // Gather the block into arrays. An actor that is not added has a weight of 0 in the plane of channel 0, the last
+        // block is padded the same way, so that the loops below have no branches and always run over a whole block
+        for (int j = 0; j < RASTER_BLOCK; j++) {
+            unsigned int flags = (j < count) ? block[j].flags : 0;
+            bool added = (flags & FLAG_ACTIVE) != 0;
+            x[j] = (j < count) ? block[j].x : originX;
+            y[j] = (j < count) ? block[j].y : originY;
+            channel[j] = added ? TYPE_CHANNELS[flags & FLAG_TYPE_MASK] : 0;
+            weight[j] = added ? 1.0f : 0.0f;
+        }
+
+        // A flame burst stands for the flames still in play, each one is added where it is
+        for (int j = 0; j < count; j++) {
+            if (weight[j] != 0 && (block[j].flags & FLAG_TYPE_MASK) == ID_FLAME && block[j].actor->idCount() > 1) {
+                ActorState flames[FLAME_BURST_RAYS];
+                int flameCount = block[j].actor->getStates(flames);
+                for (int k = 0; k < flameCount; k++)
+                    addActor(world, resolution, falloff, channel[j], flames[k].x, flames[k].y, planes);
+                weight[j] = 0;
+            }
+        }
+
+        // Grid positions, clamped to the grid so that nothing on the rim is lost, then cells and, with falloff, the
+        // bilinear weights towards the next column and row
+        for (int j = 0; j < RASTER_BLOCK; j++) {
+            x[j] = min(max((x[j] - originX) * scale - offset, 0.0f), last);
+            y[j] = min(max((y[j] - originY) * scale - offset, 0.0f), last);
+        }
+        if (!falloff) {
+            for (int j = 0; j < RASTER_BLOCK; j++)
+                cell[j] = channel[j] * cells + (int) y[j] * resolution + (int) x[j];
+            // Actors of a block may share a cell, so adding them stays scalar
+            for (int j = 0; j < RASTER_BLOCK; j++)
+                planes[cell[j]] += weight[j];
+            continue;
+        }
+        for (int j = 0; j < RASTER_BLOCK; j++) {
+            int column = min((int) x[j], lastFirst);
+            int row = min((int) y[j], lastFirst);
+            weightX[j] = x[j] - column;
+            weightY[j] = y[j] - row;
+            cell[j] = channel[j] * cells + row * resolution + column;
+        }
+        for (int j = 0; j < RASTER_BLOCK; j++) {
+            float* plane = planes + cell[j];
+            float right = weightX[j] * weight[j];
+            float left = weight[j] - right;
+            plane[0] += left * (1 - weightY[j]);
+            plane[next] += right * (1 - weightY[j]);
+            plane[next * resolution] += left * weightY[j];
+            plane[next * resolution + next] += right * weightY[j];
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef OCCUPANCYGRID_H_
+#define OCCUPANCYGRID_H_
+
+#include "StudentWorld.h"
+
+// Rasterizes the actors of a world into a fixed-size grid of channel planes, for training and analytics tools
+// The grid covers the square around the dish, row 0 at the bottom. Planes follow each other in channel order, each one
+// resolution * resolution floats, row by row. Every actor adds a weight of 1 to the plane of its channel
+
+// Channels
+const int CHANNEL_DIRT                  = 0;
+const int CHANNEL_FOOD                  = 1;
+const int CHANNEL_PIT                   = 2;
+const int CHANNEL_REGULAR_SALMONELLA    = 3;
+const int CHANNEL_AGGRESSIVE_SALMONELLA = 4;
+const int CHANNEL_ECOLI                 = 5;
+const int CHANNEL_PROJECTILES           = 6;    // Sprays and flames
+const int CHANNEL_GOODIES               = 7;    // Health, flame and life goodies
+const int CHANNEL_FUNGUS                = 8;
+const int CHANNEL_SOCRATES              = 9;
+const int NUMBER_OF_CHANNELS            = 10;
+
+// Actors go through in blocks this big: a block is gathered into arrays, its positions are turned into cells and
+// weights in branch-free loops over the whole block, which GCC vectorizes at -O2, then it is added to the planes one
+// actor at a time, since actors may share a cell
+const int RASTER_BLOCK                  = 64;
+
+// Return the number of floats of a grid
+int occupancyGridSize(int resolution);
+
+// Overwrite planes with the actors of a world
+// Without falloff an actor lands whole in the cell holding its center. With falloff its weight is spread over the four
+// cells whose centers surround it, each getting more the closer the actor is to it
+void rasterizeWorld(const StudentWorld& world, int resolution, bool falloff, float* planes);
+
+#endif // OCCUPANCYGRID_H_
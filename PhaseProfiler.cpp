@@ -0,0 +1,237 @@
+#include "PhaseProfiler.h"
+#include <chrono>
+#include <sstream>
+#include <map>
+#include <cstdlib>
+#include <cstring>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+namespace {
+
+// Nanoseconds on the monotonic clock
+long long nowNanoseconds() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifdef __linux__
+// Open one hardware counter of the calling thread in user space, in the group of groupFile unless it is -1
+int openCounter(unsigned long long config, int groupFile) {
+    perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.config = config;
+    attributes.disabled = (groupFile == -1);
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_GROUP;
+    return (int) syscall(__NR_perf_event_open, &attributes, 0, -1, groupFile, 0);
+}
+#endif
+
+// Find a number after "key": in a line of JSON, 0 if it is not there
+double jsonNumber(const string& line, const string& key) {
+    size_t at = line.find("\"" + key + "\":");
+    if (at == string::npos)
+        return 0;
+    return strtod(line.c_str() + at + key.size() + 3, nullptr);
+}
+
+// Find a string after "key": in a line of JSON, empty if it is not there
+string jsonString(const string& line, const string& key) {
+    size_t at = line.find("\"" + key + "\":");
+    if (at == string::npos)
+        return "";
+    size_t start = line.find('"', at + key.size() + 3);
+    size_t end = line.find('"', start + 1);
+    if (start == string::npos || end == string::npos)
+        return "";
+    return line.substr(start + 1, end - start - 1);
+}
+
+// Whether a run written by writeJson has hardware counters
+bool hasCycles(const string& json) {
+    return json.find("\"backend\": \"perf_event\"") != string::npos;
+}
+
+// Per tick cost of every phase in a run written by writeJson, in cycles or in wall time
+map<string, double> phaseCosts(const string& json, bool cycles) {
+    map<string, double> costs;
+    istringstream in(json);
+    string line;
+    double ticks = 1;
+    while (getline(in, line)) {
+        if (line.find("\"name\":") != string::npos)
+            costs[jsonString(line, "name")] = jsonNumber(line, cycles ? "cycles" : "wall_ns") / ticks;
+        else if (line.find("\"ticks\":") != string::npos)
+            ticks = max(jsonNumber(line, "ticks"), 1.0);
+    }
+    return costs;
+}
+
+}
+
+// Constructor, opens the counters if the kernel allows it
+PhaseProfiler::PhaseProfiler()
+    : m_counterGroup(-1), m_phase(PHASE_NONE), m_phaseStartWall(0), m_ticks(0)
+{
+    for (int i = 0; i < NUMBER_OF_COUNTERS; i++)
+        m_counterFiles[i] = -1;
+    reset();
+
+#ifdef __linux__
+    const unsigned long long configs[NUMBER_OF_COUNTERS] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+    for (int i = 0; i < NUMBER_OF_COUNTERS; i++) {
+        m_counterFiles[i] = openCounter(configs[i], (i == 0) ? -1 : m_counterFiles[0]);
+        if (m_counterFiles[i] < 0) {
+            // All or nothing, a partial set of counters would make the phases incomparable between hosts
+            for (int k = 0; k < i; k++)
+                close(m_counterFiles[k]);
+            for (int k = 0; k < NUMBER_OF_COUNTERS; k++)
+                m_counterFiles[k] = -1;
+            return;
+        }
+    }
+    m_counterGroup = m_counterFiles[0];
+    ioctl(m_counterGroup, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(m_counterGroup, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+// Destructor
+PhaseProfiler::~PhaseProfiler() {
+#ifdef __linux__
+    for (int i = 0; i < NUMBER_OF_COUNTERS; i++) {
+        if (m_counterFiles[i] >= 0)
+            close(m_counterFiles[i]);
+    }
+#endif
+}
+
+// Return whether hardware counters are measured, rather than only wall time
+bool PhaseProfiler::hasCounters() const {
+    return m_counterGroup >= 0;
+}
+
+// Read the clock and, if they are open, the counters
+void PhaseProfiler::sample(long long& wall, long long counters[]) const {
+    for (int i = 0; i < NUMBER_OF_COUNTERS; i++)
+        counters[i] = 0;
+#ifdef __linux__
+    if (m_counterGroup >= 0) {
+        unsigned long long values[1 + NUMBER_OF_COUNTERS];
+        if (read(m_counterGroup, values, sizeof(values)) == (ssize_t) sizeof(values)) {
+            for (int i = 0; i < NUMBER_OF_COUNTERS; i++)
+                counters[i] = (long long) values[1 + i];
+        }
+    }
+#endif
+    wall = nowNanoseconds();
+}
+
+// Charge the running phase and switch to another one
+void PhaseProfiler::enter(int phase) {
+    if (phase == m_phase)
+        return;
+    long long wall;
+    long long counters[NUMBER_OF_COUNTERS];
+    sample(wall, counters);
+    if (m_phase != PHASE_NONE) {
+        PhaseTotals& totals = m_totals[m_phase];
+        totals.wallNanoseconds += wall - m_phaseStartWall;
+        for (int i = 0; i < NUMBER_OF_COUNTERS; i++)
+            totals.counters[i] += counters[i] - m_phaseStartCounters[i];
+    }
+    if (phase != PHASE_NONE)
+        m_totals[phase].entries++;
+    m_phase = phase;
+    m_phaseStartWall = wall;
+    for (int i = 0; i < NUMBER_OF_COUNTERS; i++)
+        m_phaseStartCounters[i] = counters[i];
+}
+
+// Charge the last phase of the tick and count the tick
+void PhaseProfiler::endTick() {
+    enter(PHASE_NONE);
+    m_ticks++;
+}
+
+// Forget everything measured so far
+void PhaseProfiler::reset() {
+    m_phase = PHASE_NONE;
+    m_ticks = 0;
+    for (int p = 0; p < NUMBER_OF_PHASES; p++) {
+        m_totals[p].entries = 0;
+        m_totals[p].wallNanoseconds = 0;
+        for (int i = 0; i < NUMBER_OF_COUNTERS; i++)
+            m_totals[p].counters[i] = 0;
+    }
+}
+
+// Return the number of ticks measured
+int PhaseProfiler::ticks() const {
+    return m_ticks;
+}
+
+// Return the totals of a phase
+const PhaseTotals& PhaseProfiler::totals(int phase) const {
+    return m_totals[phase];
+}
+
+// Return the name of a phase as it appears in the JSON output
+const char* PhaseProfiler::phaseName(int phase) {
+    static const char* const names[NUMBER_OF_PHASES] = { "player", "broadphase", "pits", "projectiles", "items", "bacteria", "cleanup", "spawning", "hud" };
+    return (phase >= 0 && phase < NUMBER_OF_PHASES) ? names[phase] : "none";
+}
+
+// Return the name of a counter as it appears in the JSON output
+const char* PhaseProfiler::counterName(int counter) {
+    static const char* const names[NUMBER_OF_COUNTERS] = { "cycles", "instructions", "cache_misses", "branch_misses" };
+    return names[counter];
+}
+
+// Write the totals of every phase as JSON
+void PhaseProfiler::writeJson(ostream& out, const string& label) const {
+    out << "{" << endl;
+    out << "  \"label\": \"" << label << "\"," << endl;
+    out << "  \"backend\": \"" << (hasCounters() ? "perf_event" : "wall_time") << "\"," << endl;
+    out << "  \"ticks\": " << m_ticks << "," << endl;
+    out << "  \"phases\": [" << endl;
+    for (int p = 0; p < NUMBER_OF_PHASES; p++) {
+        const PhaseTotals& totals = m_totals[p];
+        out << "    {\"name\": \"" << phaseName(p) << "\", \"entries\": " << totals.entries << ", \"wall_ns\": " << totals.wallNanoseconds;
+        if (hasCounters()) {
+            for (int i = 0; i < NUMBER_OF_COUNTERS; i++)
+                out << ", \"" << counterName(i) << "\": " << totals.counters[i];
+        }
+        out << "}" << (p + 1 < NUMBER_OF_PHASES ? "," : "") << endl;
+    }
+    out << "  ]" << endl;
+    out << "}" << endl;
+}
+
+// Compare two runs phase by phase. Cycles are compared when both runs have them, wall time otherwise
+int compareWithBaseline(const string& currentJson, const string& baselineJson, double tolerance, ostream& out) {
+    bool cycles = hasCycles(currentJson) && hasCycles(baselineJson);
+    map<string, double> current = phaseCosts(currentJson, cycles);
+    map<string, double> baseline = phaseCosts(baselineJson, cycles);
+    const char* unit = cycles ? "cycles/tick" : "ns/tick";
+    int regressions = 0;
+    for (map<string, double>::const_iterator p = current.begin(); p != current.end(); p++) {
+        map<string, double>::const_iterator base = baseline.find(p->first);
+        if (base == baseline.end() || base->second <= 0)
+            continue;
+        double change = p->second / base->second - 1;
+        if (change > tolerance) {
+            out << "regression: " << p->first << " " << base->second << " -> " << p->second << " " << unit << " (+" << change * 100 << "%)" << endl;
+            regressions++;
+        }
+    }
+    return regressions;
+}
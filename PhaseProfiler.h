@@ -0,0 +1,72 @@
+#ifndef PHASEPROFILER_H_
+#define PHASEPROFILER_H_
+
+#include <string>
+#include <ostream>
+
+// Optional instrumentation of the phases of StudentWorld::move
+// On Linux each phase is measured with hardware counters from perf_event_open: cycles, instructions, cache misses and
+// branch misses. Where the counters cannot be opened only wall time is measured
+
+const int PHASE_NONE            = -1;
+const int PHASE_PLAYER          = 0;
+const int PHASE_BROADPHASE      = 1;
+const int PHASE_PITS            = 2;
+const int PHASE_PROJECTILES     = 3;
+const int PHASE_ITEMS           = 4;
+const int PHASE_BACTERIA        = 5;
+const int PHASE_CLEANUP         = 6;
+const int PHASE_SPAWNING        = 7;
+const int PHASE_HUD             = 8;
+const int NUMBER_OF_PHASES      = 9;
+
+const int COUNTER_CYCLES        = 0;
+const int COUNTER_INSTRUCTIONS  = 1;
+const int COUNTER_CACHE_MISSES  = 2;
+const int COUNTER_BRANCH_MISSES = 3;
+const int NUMBER_OF_COUNTERS    = 4;
+
+// Totals of one phase over every tick measured
+struct PhaseTotals {
+    long long entries;
+    long long wallNanoseconds;
+    long long counters[NUMBER_OF_COUNTERS];
+};
+
+class PhaseProfiler {
+  public:
+    PhaseProfiler();
+    ~PhaseProfiler();
+    bool hasCounters() const;
+
+    // Charge everything from now on to a phase, until another phase is entered or the tick ends
+    // Entering the phase that is already running costs nothing, so the update loop can enter one per actor
+    void enter(int phase);
+    void endTick();
+    void reset();
+
+    int ticks() const;
+    const PhaseTotals& totals(int phase) const;
+    static const char* phaseName(int phase);
+    static const char* counterName(int counter);
+
+    // One JSON object per run, with one line per phase so that results can be diffed and compared line by line
+    void writeJson(std::ostream& out, const std::string& label) const;
+  private:
+    int m_counterGroup;             // File descriptor of the group leader, -1 when only wall time is measured
+    int m_counterFiles[NUMBER_OF_COUNTERS];
+    int m_phase;
+    long long m_phaseStartWall;
+    long long m_phaseStartCounters[NUMBER_OF_COUNTERS];
+    int m_ticks;
+    PhaseTotals m_totals[NUMBER_OF_PHASES];
+
+    // Helper Functions
+    void sample(long long& wall, long long counters[]) const;
+};
+
+// Compare a run against a baseline written by writeJson, phase by phase, per tick
+// Prints every phase that got slower by more than the tolerance and returns how many did
+int compareWithBaseline(const std::string& currentJson, const std::string& baselineJson, double tolerance, std::ostream& out);
+
+#endif // PHASEPROFILER_H_
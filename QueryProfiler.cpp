@@ -0,0 +1,158 @@
+#include "QueryProfiler.h"
+#include "StudentWorld.h"
+#include "Actor.h"
+#include <iomanip>
+#include <algorithm>
+using namespace std;
+
+// Constructor
+QueryProfiler::QueryProfiler(int resolution, int ticksPerFrame)
+    : m_resolution(max(resolution, 1)), m_ticksPerFrame(max(ticksPerFrame, 1)), m_left(0), m_bottom(0), m_cellSize(1), m_ticks(0)
+{
+    reset();
+}
+
+// Span the grid over a dish, its cells are square and as many across as the resolution
+void QueryProfiler::setDish(double centerX, double centerY, double radius) {
+    m_left = centerX - radius;
+    m_bottom = centerY - radius;
+    m_cellSize = max(2 * radius / m_resolution, 1e-9);
+}
+
+// Charge a query to its call site and to the cell it was made in
+void QueryProfiler::record(int site, double x, double y, double radius, int examined, int hits) {
+    QuerySiteStats& stats = m_sites[site];
+    stats.queries++;
+    stats.examined += examined;
+    stats.hits += hits;
+    int slot = 0;
+    while (slot < QUERY_RADII && stats.radiusQueries[slot] > 0 && stats.radii[slot] != radius)
+        slot++;
+    if (slot < QUERY_RADII)
+        stats.radii[slot] = radius;
+    stats.radiusQueries[slot]++;
+    m_frames.back().cells[HEATMAP_QUERIES][cellOf(x, y)]++;
+}
+
+// Count a tick, and at the end of a frame count where the player and every active actor are before starting the next one
+// The level is kept up to date every tick, so that a frame the game ends partway through has one too
+void QueryProfiler::endTick(const StudentWorld& world) {
+    m_ticks++;
+    HeatmapFrame& frame = m_frames.back();
+    frame.level = world.getLevel();
+    if (m_ticks % m_ticksPerFrame != 0)
+        return;
+    vector<int>& actors = frame.cells[HEATMAP_ACTORS];
+    if (world.player() != nullptr && world.player()->isActive())
+        actors[cellOf(world.player()->getX(), world.player()->getY())]++;
+    const vector<ActorRecord>& records = world.records();
+    ActorState flames[FLAME_BURST_RAYS];
+    for (size_t i = 0; i < records.size(); i++) {
+        if (!(records[i].flags & FLAG_ACTIVE))
+            continue;
+        // A flame burst stands for the flames still in play, each one is counted where it is
+        if ((records[i].flags & FLAG_TYPE_MASK) == ID_FLAME && records[i].actor->idCount() > 1) {
+            int flameCount = records[i].actor->getStates(flames);
+            for (int k = 0; k < flameCount; k++)
+                actors[cellOf(flames[k].x, flames[k].y)]++;
+        }
+        else
+            actors[cellOf(records[i].x, records[i].y)]++;
+    }
+    startFrame(m_ticks);
+}
+
+// Forget every query and frame
+void QueryProfiler::reset() {
+    m_ticks = 0;
+    for (int site = 0; site < NUMBER_OF_QUERY_SITES; site++) {
+        QuerySiteStats& stats = m_sites[site];
+        stats.queries = 0;
+        stats.examined = 0;
+        stats.hits = 0;
+        for (int slot = 0; slot < QUERY_RADII; slot++)
+            stats.radii[slot] = 0;
+        for (int slot = 0; slot <= QUERY_RADII; slot++)
+            stats.radiusQueries[slot] = 0;
+    }
+    m_frames.clear();
+    startFrame(0);
+}
+
+// Return the totals of a call site
+const QuerySiteStats& QueryProfiler::siteStats(int site) const {
+    return m_sites[site];
+}
+
+// Return the frames so far, the last of which is still being counted
+const vector<HeatmapFrame>& QueryProfiler::frames() const {
+    return m_frames;
+}
+
+// Return the name of a call site
+const char* QueryProfiler::siteName(int site) {
+    static const char* const names[NUMBER_OF_QUERY_SITES] = { "projectile_hits", "food_contacts", "player_contacts", "dirt_checks",
+        "food_search", "projectile_paths", "flame_bursts", "points", "overlaps" };
+    return (site >= 0 && site < NUMBER_OF_QUERY_SITES) ? names[site] : "?";
+}
+
+// Write one line per call site that made any queries, then one per radius it made them with
+void QueryProfiler::writeSummary(ostream& out) const {
+    out << fixed << setprecision(2);
+    out << "site\tqueries\texamined/query\thits/query\thit rate" << endl;
+    for (int site = 0; site < NUMBER_OF_QUERY_SITES; site++) {
+        const QuerySiteStats& stats = m_sites[site];
+        if (stats.queries == 0)
+            continue;
+        out << siteName(site) << "\t" << stats.queries << "\t" << (double) stats.examined / stats.queries << "\t"
+            << (double) stats.hits / stats.queries << "\t" << ((stats.examined > 0) ? (double) stats.hits / stats.examined : 0.0) << endl;
+    }
+    out << "site\tradius\tqueries\tshare" << endl;
+    for (int site = 0; site < NUMBER_OF_QUERY_SITES; site++) {
+        const QuerySiteStats& stats = m_sites[site];
+        for (int slot = 0; slot <= QUERY_RADII; slot++) {
+            if (stats.radiusQueries[slot] == 0)
+                continue;
+            out << siteName(site) << "\t";
+            if (slot < QUERY_RADII)
+                out << stats.radii[slot];
+            else
+                out << "other";
+            out << "\t" << stats.radiusQueries[slot] << "\t" << 100.0 * stats.radiusQueries[slot] / stats.queries << "%" << endl;
+        }
+    }
+}
+
+// Write the cells of every frame that counted anything, in long form for plotting tools
+void QueryProfiler::writeHeatmaps(ostream& out) const {
+    static const char* const layers[NUMBER_OF_HEATMAP_LAYERS] = { "queries", "actors" };
+    out << "frame,first_tick,level,layer,row,column,count" << endl;
+    for (size_t f = 0; f < m_frames.size(); f++) {
+        const HeatmapFrame& frame = m_frames[f];
+        for (int layer = 0; layer < NUMBER_OF_HEATMAP_LAYERS; layer++) {
+            for (size_t cell = 0; cell < frame.cells[layer].size(); cell++) {
+                if (frame.cells[layer][cell] == 0)
+                    continue;
+                out << f << "," << frame.firstTick << "," << frame.level << "," << layers[layer] << ","
+                    << cell / m_resolution << "," << cell % m_resolution << "," << frame.cells[layer][cell] << endl;
+            }
+        }
+    }
+}
+
+// Start counting a new frame
+void QueryProfiler::startFrame(int firstTick) {
+    m_frames.emplace_back();
+    HeatmapFrame& frame = m_frames.back();
+    frame.firstTick = firstTick;
+    frame.level = 0;
+    for (int layer = 0; layer < NUMBER_OF_HEATMAP_LAYERS; layer++)
+        frame.cells[layer].assign(m_resolution * m_resolution, 0);
+}
+
+// Find the cell of a point, points off the grid count in its border cells
+int QueryProfiler::cellOf(double x, double y) const {
+    int column = min(max((int) ((x - m_left) / m_cellSize), 0), m_resolution - 1);
+    int row = min(max((int) ((y - m_bottom) / m_cellSize), 0), m_resolution - 1);
+    return row * m_resolution + column;
+}
@@ -0,0 +1,84 @@
+#ifndef QUERYPROFILER_H_
+#define QUERYPROFILER_H_
+
+#include <vector>
+#include <ostream>
+
+// Optional instrumentation of the world's spatial queries, for tuning its indexes
+// Every query made while a profiler is set is charged to its call site with the radius it was made with, the records it
+// looked at and the actors it found. Where the queries were made and where the actors were is counted in a grid over the
+// dish, one frame of both every so many ticks, so that heatmaps show how both spread while colonies grow
+
+// Call sites, by the query they make
+const int QUERY_PROJECTILE_HITS     = 0;    // firstContact: a projectile's first target
+const int QUERY_FOOD_CONTACTS       = 1;    // lastContact: the food a bacterium eats
+const int QUERY_PLAYER_CONTACTS     = 2;    // overlapsPlayer: bacteria and items touching the player
+const int QUERY_DIRT_CHECKS         = 3;    // isDirtAt: whether a bacterium's next step is blocked
+const int QUERY_FOOD_SEARCH         = 4;    // nearestActor: the food a bacterium heads for
+const int QUERY_PROJECTILE_PATHS    = 5;    // firstStaticStep: the first dirt on a projectile's path
+const int QUERY_FLAME_BURSTS        = 6;    // ringContacts: the targets of a flame burst's flames
+const int QUERY_POINTS              = 7;    // isAnyAt: anything at a point
+const int QUERY_OVERLAPS            = 8;    // getOverlap, forEachOverlap and anyOverlap
+const int NUMBER_OF_QUERY_SITES     = 9;
+
+// Distinct radii told apart for each call site, further ones are counted together
+const int QUERY_RADII               = 4;
+
+// Layers of each heatmap frame
+const int HEATMAP_QUERIES           = 0;
+const int HEATMAP_ACTORS            = 1;
+const int NUMBER_OF_HEATMAP_LAYERS  = 2;
+
+// Totals of one call site
+struct QuerySiteStats {
+    long long queries;
+    long long examined;                     // Records the queries looked at
+    long long hits;                         // Actors they found, or points and paths that were blocked
+    double radii[QUERY_RADII];
+    long long radiusQueries[QUERY_RADII + 1];   // The last one counts every other radius
+};
+
+// Counts of one stretch of ticks, by cell of the grid, row by row from the bottom of the dish: the queries made during
+// it, and the actors there were at its end
+struct HeatmapFrame {
+    int firstTick;                          // Ticks profiled before the frame
+    int level;                              // At its end
+    std::vector<int> cells[NUMBER_OF_HEATMAP_LAYERS];
+};
+
+class StudentWorld;
+
+class QueryProfiler {
+  public:
+    QueryProfiler(int resolution = 32, int ticksPerFrame = 100);
+
+    // Called by the world: the dish the grid spans, every query, and the end of every tick with the world as it is then
+    void setDish(double centerX, double centerY, double radius);
+    void record(int site, double x, double y, double radius, int examined, int hits);
+    void endTick(const StudentWorld& world);
+    void reset();
+
+    const QuerySiteStats& siteStats(int site) const;
+    const std::vector<HeatmapFrame>& frames() const;
+    static const char* siteName(int site);
+
+    // A table of the call sites with their radii, and the frames as CSV rows of frame, first tick, level, layer, row,
+    // column and count, one row for each cell that counted anything
+    void writeSummary(std::ostream& out) const;
+    void writeHeatmaps(std::ostream& out) const;
+  private:
+    int m_resolution;
+    int m_ticksPerFrame;
+    double m_left;
+    double m_bottom;
+    double m_cellSize;
+    int m_ticks;
+    QuerySiteStats m_sites[NUMBER_OF_QUERY_SITES];
+    std::vector<HeatmapFrame> m_frames;     // The last one is being counted
+
+    // Helper Functions
+    void startFrame(int firstTick);
+    int cellOf(double x, double y) const;
+};
+
+#endif // QUERYPROFILER_H_
@@ -0,0 +1,37 @@
+#include "RenderBuffer.h"
+using namespace std;
+
+// The middle index carries a flag for a frame the display has not taken yet
+const int RENDER_FRAME_INDEX    = 0x3;
+const int RENDER_FRAME_FRESH    = 0x4;
+
+// Constructor
+RenderBuffer::RenderBuffer()
+    : m_back(0), m_published(0), m_front(1), m_middle(2)
+{
+    for (int i = 0; i < 3; i++)
+        m_frames[i].number = 0;
+}
+
+// Return the frame the simulation fills next
+RenderFrame& RenderBuffer::backFrame() {
+    return m_frames[m_back];
+}
+
+// Make the frame just filled the newest one, and fill the one it replaces next, or the one the display gave back
+void RenderBuffer::publish() {
+    m_frames[m_back].number = ++m_published;
+    m_back = m_middle.exchange(m_back | RENDER_FRAME_FRESH, memory_order_acq_rel) & RENDER_FRAME_INDEX;
+}
+
+// Trade the frame the display last read for the newest one, if one was published since
+const RenderFrame* RenderBuffer::newestFrame() {
+    if (m_middle.load(memory_order_relaxed) & RENDER_FRAME_FRESH)
+        m_front = m_middle.exchange(m_front, memory_order_acq_rel) & RENDER_FRAME_INDEX;
+    return (m_frames[m_front].number == 0) ? nullptr : &m_frames[m_front];
+}
+
+// Return the number of frames published, simulation side only
+long long RenderBuffer::published() const {
+    return m_published;
+}
@@ -0,0 +1,53 @@
+#ifndef RENDERBUFFER_H_
+#define RENDERBUFFER_H_
+
+#include <vector>
+#include <atomic>
+
+// Render state handed from the thread that runs the ticks to a display that draws on its own schedule
+// The world writes what the display needs of every sprite into a frame at the end of a tick and publishes it. Frames live
+// in a triple buffer: the simulation fills one, the display reads another, and the third holds the newest complete frame.
+// Publishing and taking a frame each swap one index with a single atomic exchange, so neither side ever waits for the
+// other or sees a frame half written. The display always takes the newest frame, the ones it had no time for are skipped
+// The framework still draws from the GraphObjects themselves, frames are for displays of the caller's own
+
+// What the display needs of one sprite
+struct RenderSprite {
+    int imageID;
+    float x;
+    float y;
+    short direction;
+    short depth;
+    float size;
+};
+
+struct RenderFrame {
+    long long number;                   // Frames published before this one and this one, 0 for none yet
+    int tick;
+    int level;
+    unsigned int score;
+    int lives;
+    std::vector<RenderSprite> sprites;  // The player and every active actor, in id order
+};
+
+class RenderBuffer {
+  public:
+    RenderBuffer();
+
+    // Simulation side: the frame to fill, handed to the display by publish
+    RenderFrame& backFrame();
+    void publish();
+
+    // Display side: the newest frame published, nullptr before the first. It is left alone until the next call
+    const RenderFrame* newestFrame();
+
+    long long published() const;
+  private:
+    RenderFrame m_frames[3];
+    int m_back;                                 // Simulation side only
+    long long m_published;
+    int m_front;                                // Display side only
+    alignas(64) std::atomic<int> m_middle;      // The newest frame, flagged while the display has not taken it yet
+};
+
+#endif // RENDERBUFFER_H_
@@ -0,0 +1,285 @@
+#include "RewindBuffer.h"
+#include "Actor.h"
+#include <algorithm>
+using namespace std;
+
+namespace {
+
+// Plays the keys recorded for each tick back to a rewound world
+class ReplayInput : public InputSource {
+  public:
+    ReplayInput(const RewindBuffer& rewind)
+        : m_rewind(rewind)
+    {}
+    bool getKey(StudentWorld& world, int& value) {
+        return m_rewind.keyAt(world.ticks(), value);
+    }
+  private:
+    const RewindBuffer& m_rewind;
+};
+
+}
+
+// Constructor, splits the budget between the ticks, the changes and the checkpoints
+RewindBuffer::RewindBuffer(size_t memoryBudget, int checkpointInterval)
+    : m_checkpointBudget(memoryBudget / 2), m_checkpointInterval(max(checkpointInterval, 1)), m_firstTick(0), m_tickCount(0),
+      m_firstDelta(0), m_deltaCount(0), m_checkpointBytes(0), m_staticCount(0), m_staticIdSum(0)
+{
+    m_ticks.resize(max(memoryBudget / 8 / sizeof(TickRecord), (size_t) 1));
+    m_deltas.resize(max(memoryBudget * 3 / 8 / sizeof(RewindDelta), (size_t) 1));
+}
+
+// Destructor
+RewindBuffer::~RewindBuffer() {
+    clear();
+}
+
+// Forget the last level and checkpoint the one that starts
+void RewindBuffer::startLevel(StudentWorld& world) {
+    clear();
+    snapshot(world, true, m_previousStatic, m_staticCount, m_staticIdSum);
+    snapshot(world, false, m_previous, m_staticCount, m_staticIdSum);
+    takeCheckpoint(world);
+}
+
+// Record the key and the changes of the tick that just ended, checkpointing the world every so many ticks
+// Pits, food and dirt are only compared when their count or the sum of their ids changed: ids only grow, so no other
+// change to them leaves both the same
+void RewindBuffer::recordTick(StudentWorld& world, bool keyPressed, int key) {
+    size_t firstDelta = m_firstDelta + m_deltaCount;
+    int staticCount;
+    long long staticIdSum;
+    snapshot(world, false, m_current, staticCount, staticIdSum);
+    compare(m_previous);
+    if (staticCount != m_staticCount || staticIdSum != m_staticIdSum) {
+        snapshot(world, true, m_current, m_staticCount, m_staticIdSum);
+        compare(m_previousStatic);
+    }
+
+    if (m_tickCount == m_ticks.size())
+        dropOldestTick();
+    TickRecord& record = m_ticks[(m_firstTick + m_tickCount) % m_ticks.size()];
+    record.tick = world.ticks();
+    record.keyPressed = keyPressed;
+    record.key = key;
+    record.firstDelta = firstDelta;
+    record.deltas = (int) (m_firstDelta + m_deltaCount - firstDelta);
+    m_tickCount++;
+
+    if (world.ticks() % m_checkpointInterval == 0)
+        takeCheckpoint(world);
+}
+
+// Return the oldest tick there is a checkpoint for
+int RewindBuffer::oldestTick() const {
+    return m_checkpoints.empty() ? -1 : m_checkpoints[0].tick;
+}
+
+// Return the last tick recorded
+int RewindBuffer::newestTick() const {
+    if (m_checkpoints.empty())
+        return -1;
+    if (m_tickCount == 0)
+        return m_checkpoints.back().tick;
+    return m_ticks[(m_firstTick + m_tickCount - 1) % m_ticks.size()].tick;
+}
+
+// Fork the newest checkpoint at or before the tick and play the recorded keys on up to it
+StudentWorld* RewindBuffer::rewindTo(int tick) {
+    if (tick < oldestTick() || tick > newestTick())
+        return nullptr;
+    size_t k = m_checkpoints.size() - 1;
+    while (m_checkpoints[k].tick > tick)
+        k--;
+    StudentWorld* world = m_checkpoints[k].world->fork();
+    if (world == nullptr)
+        return nullptr;
+    ReplayInput input(*this);
+    world->setInputSource(&input);
+    int ticksPlayed;
+    world->fastForward(tick - m_checkpoints[k].tick, ticksPlayed);
+    world->setInputSource(nullptr);
+    return world;
+}
+
+// Copy out the changes recorded for a tick
+bool RewindBuffer::changesAt(int tick, vector<RewindDelta>& changes) const {
+    changes.clear();
+    const TickRecord* record = findTick(tick);
+    if (record == nullptr)
+        return false;
+    for (int i = 0; i < record->deltas; i++)
+        changes.push_back(m_deltas[(record->firstDelta + i) % m_deltas.size()]);
+    return true;
+}
+
+// Return the key the player read during a tick, false if none was or the tick is out of reach
+bool RewindBuffer::keyAt(int tick, int& key) const {
+    const TickRecord* record = findTick(tick);
+    if (record == nullptr || !record->keyPressed)
+        return false;
+    key = record->key;
+    return true;
+}
+
+// Return the bytes of the rings, the snapshots of the actors and the checkpoints
+size_t RewindBuffer::memoryUsed() const {
+    return m_ticks.capacity() * sizeof(TickRecord) + m_deltas.capacity() * sizeof(RewindDelta) + m_checkpoints.capacity() * sizeof(Checkpoint)
+        + (m_previous.capacity() + m_previousStatic.capacity() + m_current.capacity()) * sizeof(ActorSnapshot) + m_checkpointBytes;
+}
+
+// Add the changes from the previous state of some actors to the one just taken, which becomes the previous one
+// Both are in id order, so they are compared in one merge
+void RewindBuffer::compare(vector<ActorSnapshot>& previous) {
+    size_t p = 0;
+    size_t c = 0;
+    while (p < previous.size() || c < m_current.size()) {
+        if (c == m_current.size() || (p < previous.size() && previous[p].id < m_current[c].id))
+            addDelta(previous[p++], DELTA_DIED);
+        else if (p == previous.size() || m_current[c].id < previous[p].id)
+            addDelta(m_current[c++], DELTA_SPAWNED);
+        else {
+            int changes = 0;
+            if (m_current[c].x != previous[p].x || m_current[c].y != previous[p].y)
+                changes |= DELTA_MOVED;
+            if (m_current[c].hitPoints != previous[p].hitPoints)
+                changes |= DELTA_HIT_POINTS;
+            if (changes != 0)
+                addDelta(m_current[c], changes);
+            p++;
+            c++;
+        }
+    }
+    previous.swap(m_current);
+}
+
+// Forget every tick and checkpoint
+void RewindBuffer::clear() {
+    m_firstTick = 0;
+    m_tickCount = 0;
+    m_firstDelta = 0;
+    m_deltaCount = 0;
+    while (!m_checkpoints.empty())
+        dropCheckpoint();
+    m_previous.clear();
+    m_previousStatic.clear();
+}
+
+// Take the state of either the pits, food and dirt or every other active actor, the player and each flame of a flame
+// burst included, in id order. The player's id is the lowest. Either way the pits, food and dirt are counted and their
+// ids summed
+void RewindBuffer::snapshot(StudentWorld& world, bool staticActors, vector<ActorSnapshot>& actors, int& staticCount, long long& staticIdSum) const {
+    actors.clear();
+    staticCount = 0;
+    staticIdSum = 0;
+    ActorSnapshot actor;
+    Socrates* player = world.player();
+    if (!staticActors && player != nullptr && player->isActive()) {
+        actor.id = player->id();
+        actor.objectType = ID_SOCRATES;
+        actor.x = (float) player->getX();
+        actor.y = (float) player->getY();
+        actor.hitPoints = player->hitPoints();
+        actors.push_back(actor);
+    }
+    const vector<ActorRecord>& records = world.records();
+    const vector<int>& idOrder = world.idOrder();
+    ActorState flames[FLAME_BURST_RAYS];
+    for (size_t k = 0; k < idOrder.size(); k++) {
+        const ActorRecord& record = records[idOrder[k]];
+        if (!(record.flags & FLAG_ACTIVE))
+            continue;
+        int type = record.flags & FLAG_TYPE_MASK;
+        bool isStatic = hasType(MASK_STATIC, type);
+        if (isStatic) {
+            staticCount++;
+            staticIdSum += record.id;
+        }
+        if (isStatic != staticActors)
+            continue;
+        // A flame burst stands for the flames still in play, each one is taken under its own id. Their ids follow the
+        // burst's, and come before those of any actor after it
+        if (type == ID_FLAME && record.actor->idCount() > 1) {
+            int flameCount = record.actor->getStates(flames);
+            for (int i = 0; i < flameCount; i++) {
+                actor.id = flames[i].id;
+                actor.objectType = type;
+                actor.x = (float) flames[i].x;
+                actor.y = (float) flames[i].y;
+                actor.hitPoints = 0;
+                actors.push_back(actor);
+            }
+            continue;
+        }
+        actor.id = record.id;
+        actor.objectType = type;
+        actor.x = record.x;
+        actor.y = record.y;
+        actor.hitPoints = hasType(MASK_BACTERIA, type) ? static_cast<Agent*>(record.actor)->hitPoints() : 0;
+        actors.push_back(actor);
+    }
+}
+
+// Add a change of the current tick, making room by forgetting the oldest ticks
+// A tick with more changes than the whole ring holds keeps only the first of them
+void RewindBuffer::addDelta(const ActorSnapshot& actor, int changes) {
+    while (m_deltaCount == m_deltas.size() && m_tickCount > 0)
+        dropOldestTick();
+    if (m_deltaCount == m_deltas.size())
+        return;
+    RewindDelta& delta = m_deltas[(m_firstDelta + m_deltaCount) % m_deltas.size()];
+    delta.id = actor.id;
+    delta.objectType = actor.objectType;
+    delta.x = actor.x;
+    delta.y = actor.y;
+    delta.hitPoints = actor.hitPoints;
+    delta.changes = changes;
+    m_deltaCount++;
+}
+
+// Forget the oldest tick and its changes, and the checkpoints that can no longer be played on from
+void RewindBuffer::dropOldestTick() {
+    const TickRecord& oldest = m_ticks[m_firstTick];
+    size_t end = oldest.firstDelta + oldest.deltas;
+    m_deltaCount -= end - m_firstDelta;
+    m_firstDelta = end;
+    m_firstTick = (m_firstTick + 1) % m_ticks.size();
+    m_tickCount--;
+    // Playing on from a checkpoint needs the keys of every tick after it
+    int firstKept = (m_tickCount > 0) ? m_ticks[m_firstTick].tick : oldest.tick + 1;
+    while (!m_checkpoints.empty() && m_checkpoints[0].tick < firstKept - 1)
+        dropCheckpoint();
+}
+
+// Delete the oldest checkpoint
+void RewindBuffer::dropCheckpoint() {
+    m_checkpointBytes -= m_checkpoints[0].bytes;
+    delete m_checkpoints[0].world;
+    m_checkpoints.erase(m_checkpoints.begin());
+}
+
+// Fork the world as a checkpoint, deleting the oldest ones while the checkpoints are over their share of the budget
+void RewindBuffer::takeCheckpoint(StudentWorld& world) {
+    Checkpoint checkpoint;
+    checkpoint.tick = world.ticks();
+    checkpoint.bytes = (world.numberOfActors() + 1) * REWIND_CHECKPOINT_ACTOR_BYTES;
+    if (checkpoint.bytes > m_checkpointBudget)
+        return;
+    checkpoint.world = world.fork();
+    if (checkpoint.world == nullptr)
+        return;
+    while (!m_checkpoints.empty() && m_checkpointBytes + checkpoint.bytes > m_checkpointBudget)
+        dropCheckpoint();
+    m_checkpoints.push_back(checkpoint);
+    m_checkpointBytes += checkpoint.bytes;
+}
+
+// Return the record of a tick, nullptr if it is out of reach. The ticks of a level are recorded one after another
+const RewindBuffer::TickRecord* RewindBuffer::findTick(int tick) const {
+    if (m_tickCount == 0)
+        return nullptr;
+    int offset = tick - m_ticks[m_firstTick].tick;
+    if (offset < 0 || offset >= (int) m_tickCount)
+        return nullptr;
+    return &m_ticks[(m_firstTick + offset) % m_ticks.size()];
+}
@@ -0,0 +1,113 @@
+#ifndef REWINDBUFFER_H_
+#define REWINDBUFFER_H_
+
+#include "StudentWorld.h"
+#include <vector>
+#include <cstddef>
+
+// In-memory rewind history of the level being played, bounded by a memory budget
+// Every tick records the key the player read and what changed: the actors that moved, changed hit points, spawned or
+// died. Every so many ticks the world is forked as a full checkpoint. Rewinding forks the newest checkpoint at or before
+// the tick asked for and plays the recorded keys on from there, which plays exactly the same game. The history starts
+// over with each level, and needs the optimized engine, the only one that forks
+// The rings and the checkpoints stay within the budget, the snapshots of the level's actors the changes are found from
+// come on top of it
+
+// What changed about an actor during a tick
+const int DELTA_MOVED           = 0x1;
+const int DELTA_HIT_POINTS      = 0x2;
+const int DELTA_SPAWNED         = 0x4;
+const int DELTA_DIED            = 0x8;
+
+struct RewindDelta {
+    int id;
+    int objectType;
+    float x;
+    float y;
+    int hitPoints;                      // Bacteria and the player only
+    int changes;                        // DELTA_* bits
+};
+
+// Ticks between checkpoints, rewinding replays at most this many
+const int REWIND_CHECKPOINT_INTERVAL    = 60;
+
+// Estimated cost of a checkpoint for each actor of the level: its record, its place in the list and the copy the world
+// makes of it the first time it changes after the fork
+const std::size_t REWIND_CHECKPOINT_ACTOR_BYTES = 160;
+
+class RewindBuffer {
+  public:
+    RewindBuffer(std::size_t memoryBudget, int checkpointInterval = REWIND_CHECKPOINT_INTERVAL);
+    ~RewindBuffer();
+
+    // Called by the world: when a level starts, and at the end of every tick with the key the player read
+    void startLevel(StudentWorld& world);
+    void recordTick(StudentWorld& world, bool keyPressed, int key);
+
+    // The ticks the world can be rewound to, -1 for both while there is no checkpoint
+    int oldestTick() const;
+    int newestTick() const;
+
+    // A new headless world as the recorded one was at the end of a tick, nullptr if the tick is out of reach
+    // The caller owns it, it has no input source
+    StudentWorld* rewindTo(int tick);
+
+    // The changes recorded for a tick, false if it is out of reach
+    bool changesAt(int tick, std::vector<RewindDelta>& changes) const;
+
+    // The key the player read during a tick, false if none was or the tick is out of reach
+    bool keyAt(int tick, int& key) const;
+
+    // Bytes the history takes up, the checkpoints by their estimate
+    std::size_t memoryUsed() const;
+  private:
+    struct TickRecord {
+        int tick;
+        bool keyPressed;
+        int key;
+        std::size_t firstDelta;         // Running count of deltas recorded before this tick
+        int deltas;
+    };
+    struct Checkpoint {
+        int tick;
+        StudentWorld* world;
+        std::size_t bytes;
+    };
+    // The last state recorded of each actor, in id order
+    struct ActorSnapshot {
+        int id;
+        int objectType;
+        float x;
+        float y;
+        int hitPoints;
+    };
+
+    std::size_t m_checkpointBudget;
+    int m_checkpointInterval;
+    std::vector<TickRecord> m_ticks;    // Ring, m_firstTick is the running count of the oldest one kept
+    std::size_t m_firstTick;
+    std::size_t m_tickCount;
+    std::vector<RewindDelta> m_deltas;  // Ring, m_firstDelta is the running count of the oldest one kept
+    std::size_t m_firstDelta;
+    std::size_t m_deltaCount;
+    std::vector<Checkpoint> m_checkpoints; // Oldest first
+    std::size_t m_checkpointBytes;
+    // Pits, food and dirt never move or change hit points, they are only compared when the ones there are change
+    std::vector<ActorSnapshot> m_previous;
+    std::vector<ActorSnapshot> m_previousStatic;
+    std::vector<ActorSnapshot> m_current;
+    int m_staticCount;
+    long long m_staticIdSum;
+
+    // Helper Functions
+    void clear();
+    void snapshot(StudentWorld& world, bool staticActors, std::vector<ActorSnapshot>& actors, int& staticCount, long long& staticIdSum) const;
+    void compare(std::vector<ActorSnapshot>& previous);
+    void addDelta(const ActorSnapshot& actor, int changes);
+    void dropOldestTick();
+    void dropCheckpoint();
+    void takeCheckpoint(StudentWorld& world);
+    const TickRecord* findTick(int tick) const;
+};
+
+#endif // REWINDBUFFER_H_
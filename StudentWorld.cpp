@@ -1,34 +1,135 @@
 #include "StudentWorld.h"
 #include "GameConstants.h"
 #include <string>
-#include <sstream>
+#include <cstdio>
 #include "Actor.h"
+#include "PhaseProfiler.h"
+#include "AllocationTracker.h"
+#include "Telemetry.h"
+#include "RewindBuffer.h"
+#include "RenderBuffer.h"
+#include "QueryProfiler.h"
 #include <math.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <future>
 using namespace std;
 
 GameWorld* createStudentWorld(string assetPath)
 {
-	return new StudentWorld(assetPath);
+    StudentWorld* world = new StudentWorld(assetPath);
+    
+    // An optional world.cfg among the assets replaces the original dish and levels, see WorldConfig.h
+    string configPath = assetPath + "/world.cfg";
+    if (ifstream(configPath.c_str()).good()) {
+        WorldConfig config = defaultWorldConfig();
+        string error;
+        if (loadWorldConfig(configPath, config, error))
+            world->setWorldConfig(config);
+        else
+            cerr << configPath << ": " << error << ", playing the original dish" << endl;
+    }
+	return world;
+}
+
+namespace {
+
+// Charges a query to the world's query profiler, if it has one, however the query returns
+class QueryRecord {
+  public:
+    QueryRecord(QueryProfiler* profiler, int site, double x, double y, double radius)
+        : examined(0), hits(0), m_profiler(profiler), m_site(site), m_x(x), m_y(y), m_radius(radius)
+    {}
+    ~QueryRecord() {
+        if (m_profiler != nullptr)
+            m_profiler->record(m_site, m_x, m_y, m_radius, examined, hits);
+    }
+    int examined;
+    int hits;
+  private:
+    QueryProfiler* m_profiler;
+    int m_site;
+    double m_x;
+    double m_y;
+    double m_radius;
+};
+
+// Draw a number in [min, max] the way the world draws every random roll
+template <typename Random>
+int rollInt(Random& random, int min, int max) {
+    if (max < min)
+        swap(max, min);
+    uniform_int_distribution<int> distribution(min, max);
+    return distribution(random);
+}
+
+// Copy of a generator that counts the numbers drawn from it, so that the original can be moved past them with discard
+class CountingRandom {
+  public:
+    typedef mt19937::result_type result_type;
+    CountingRandom(const mt19937& random)
+        : m_random(random), m_draws(0)
+    {}
+    static constexpr result_type min() {
+        return mt19937::min();
+    }
+    static constexpr result_type max() {
+        return mt19937::max();
+    }
+    result_type operator()() {
+        m_draws++;
+        return m_random();
+    }
+    unsigned long long draws() const {
+        return m_draws;
+    }
+  private:
+    mt19937 m_random;
+    unsigned long long m_draws;
+};
+
 }
 
 // Constructor
-StudentWorld::StudentWorld(string assetPath)
-    : GameWorld(assetPath), m_pits(0), m_player(nullptr)
-{}
+StudentWorld::StudentWorld(string assetPath, bool headless)
+    : GameWorld(assetPath), m_player(nullptr), m_inTick(false), m_contactsValid(false), m_broadphaseMargin(BROADPHASE_MARGIN), m_staticCellsValid(false), m_staticColumns(0), m_staticVersion(0), m_wakeColumns(0), m_playerMoves(0),
+      m_spatialReordering(true), m_reorders(0), m_arenaHighWater(0), m_config(defaultWorldConfig()), m_aiBudgetUsed(0), m_pits(0), m_headless(headless), m_input(nullptr), m_profiler(nullptr), m_telemetry(nullptr), m_rewind(nullptr),
+      m_render(nullptr), m_queryProfiler(nullptr), m_tickKeyPressed(false), m_tickKey(0), m_random(random_device()()), m_layoutRandom(random_device()()), m_pregenerateLevels(false), m_engine(ENGINE_OPTIMIZED), m_ticks(0),
+      m_nextActorId(0), m_bacteria(0), m_ticksPerMove(1), m_jumpedTicks(0), m_keyPending(false), m_pendingKeyPressed(false), m_pendingKey(0)
+{
+    m_spawns.reserve(SPAWN_BUFFER_RESERVE);
+    
+    // Level of detail is off by default, these bands are a starting point for when it is enabled
+    AILevelOfDetail settings;
+    settings.enabled = false;
+    settings.bandDistance[0] = 96;
+    settings.bandDistance[1] = 160;
+    settings.bandDistance[2] = 224;
+    settings.bandInterval[0] = 2;
+    settings.bandInterval[1] = 4;
+    settings.bandInterval[2] = 8;
+    settings.budget = 0;
+    setAILevelOfDetail(settings);
+    resetWakeCells();
+}
 
 // Destructor
 StudentWorld::~StudentWorld() {
+    discardLayouts();
     cleanUp();
 }
 
-// Hepler function that gets a random point within the petri dish
-void StudentWorld::getRandomPoint(double &x, double &y) {
-    int R = 120;
-    double shiftX = VIEW_WIDTH / 2;
-    double shiftY = VIEW_HEIGHT / 2;
+// Hepler function that gets a random point within the area of the petri dish that objects are placed in
+void StudentWorld::getRandomPoint(const WorldConfig& config, mt19937& random, double &x, double &y) {
+    double R = config.placementRadius;
+    double shiftX = config.dishRadius;
+    double shiftY = config.dishRadius;
 
-    double rand1 = ((double) rand () / (RAND_MAX));
-    double rand2 = ((double) rand () / (RAND_MAX));
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    double rand1 = unit(random);
+    double rand2 = unit(random);
     
     double theta = rand1 * 2 * M_PI;
     
@@ -38,186 +139,1396 @@ void StudentWorld::getRandomPoint(double &x, double &y) {
     y = r * sin (theta) + shiftY;
 }
 
+// Lay out the pits, food and dirt of a level, drawing every position from a copy of the given generator
+// Only reads its arguments, so it can run on any thread
+LevelLayout StudentWorld::generateLayout(const WorldConfig& config, int level, const mt19937& random) {
+    LevelLayout layout;
+    layout.level = level;
+    layout.random = random;
+    layout.objects.reserve(config.pits(level) + config.food(level) + config.dirt(level));
+    
+    // Pits and food placed so far, by grid cell. Cells are wider than the overlap radius, so a point can only
+    // overlap objects in its own cell and the eight around it
+    int columns = (int) (2 * config.dishRadius / STATIC_GRID_CELL) + 1;
+    vector<vector<int>> taken(columns * columns);
+    auto cellOf = [columns](double position) { return min(max((int) floor(position / STATIC_GRID_CELL), 0), columns - 1); };
+    auto isTaken = [&](double x, double y) {
+        int column = cellOf(x);
+        int row = cellOf(y);
+        for (int r = max(row - 1, 0); r <= min(row + 1, columns - 1); r++) {
+            for (int c = max(column - 1, 0); c <= min(column + 1, columns - 1); c++) {
+                const vector<int>& cell = taken[r * columns + c];
+                for (size_t k = 0; k < cell.size(); k++) {
+                    const LayoutObject& object = layout.objects[cell[k]];
+                    if (pointsOverlap(x, y, object.x, object.y, 2*SPRITE_RADIUS))
+                        return true;
+                }
+            }
+        }
+        return false;
+    };
+    
+    // Pits, food and dirt may not be placed on top of pits or food, rejected points are drawn again
+    auto place = [&](int objectType, int count) {
+        for (int i = 0; i < count; i++) {
+            LayoutObject object;
+            object.objectType = objectType;
+            do {
+                getRandomPoint(config, layout.random, object.x, object.y);
+            } while (isTaken(object.x, object.y));
+            if (objectType != ID_DIRT)
+                taken[cellOf(object.y) * columns + cellOf(object.x)].push_back((int) layout.objects.size());
+            layout.objects.push_back(object);
+        }
+    };
+    place(ID_PIT, config.pits(level));
+    place(ID_FOOD, config.food(level));
+    place(ID_DIRT, config.dirt(level));
+    return layout;
+}
+
+// Get the layout of a level: the one prepared in the background if it is for this level, otherwise a new one
+LevelLayout StudentWorld::takeLayout(int level) {
+    if (m_preparedLayouts.valid()) {
+        vector<LevelLayout> prepared = m_preparedLayouts.get();
+        for (size_t i = 0; i < prepared.size(); i++) {
+            if (prepared[i].level == level)
+                return prepared[i];
+        }
+    }
+    return generateLayout(m_config, level, m_pregenerateLevels ? m_layoutRandom : m_random);
+}
+
+// Start laying out the levels that can follow the current one on a worker thread: the same level again, in case the
+// player dies, and the next one. Both start from the same state of the layout generator, only the one used is kept
+void StudentWorld::prepareLayouts() {
+    WorldConfig config = m_config;
+    int level = getLevel();
+    mt19937 random = m_layoutRandom;
+    m_preparedLayouts = async(launch::async, [config, level, random]() {
+        vector<LevelLayout> prepared;
+        prepared.push_back(generateLayout(config, level, random));
+        prepared.push_back(generateLayout(config, level + 1, random));
+        return prepared;
+    });
+}
+
+// Throw away layouts prepared in the background, after whatever they were made from has changed
+void StudentWorld::discardLayouts() {
+    if (m_preparedLayouts.valid())
+        m_preparedLayouts.get();
+}
+
+// Construct one of the long-lived actors of the level in the level's arena
+template <typename T>
+T* StudentWorld::newLevelActor(double x, double y) {
+    T* actor = new (*m_arena) T(this, x, y);
+    actor->setInArena();
+    return actor;
+}
+
 // Initiazes the student world at the beginning of each level
 int StudentWorld::init()
 {
     int L = getLevel();
     
-    // Creates a new Socrates player for the current level
-    m_player = new Socrates(this, 0, VIEW_HEIGHT/2);
+    // Creates a new Socrates player for the current level, in the arena the level's long-lived actors come from
+    if (m_arena == nullptr)
+        m_arena = make_shared<LevelArena>(m_arenaHighWater);
+    m_player = newLevelActor<Socrates>(0, dishCenterY());
+    m_player->setId(0);
+    m_nextActorId = 1;
+    m_ticks = 0;
     
     // Initializes initial amount of pits
     m_pits = 0;
     
-    double x;
-    double y;
-    
-    // Creates L number of pits for the current level
-    for (int i = 0; i < L; i++) {
-        Pit* pit = nullptr;
-        bool overlap = false;
-        // Make sure pits do not overlap with other pits
-        do {
-            getRandomPoint(x, y);
-            pit = new Pit(this, x, y);
-            list<Actor*> overlaps;
-            overlap = false;
-            getOverlap(pit, overlaps, 2*SPRITE_RADIUS);
-            for (list<Actor*>::iterator p = overlaps.begin(); p != overlaps.end(); p++) {
-                if ((*p)->objectType() == ID_PIT || (*p)->objectType() == ID_FOOD) {
-                    overlap = true;
-                    delete pit;
-                }
-            }
-        } while (overlap);
-            
-        if (pit != nullptr) {
-            m_actors.push_back(pit);
+    // Creates the pits, food and dirt of the level where its layout put them, and carries on with the generator
+    // the layout was drawn from
+    LevelLayout layout = takeLayout(L);
+    reserveRecords(layout.objects.size());
+    for (size_t i = 0; i < layout.objects.size(); i++) {
+        const LayoutObject& object = layout.objects[i];
+        if (object.objectType == ID_PIT) {
+            insertActor(newLevelActor<Pit>(object.x, object.y));
             m_pits++;
         }
+        else if (object.objectType == ID_FOOD)
+            insertActor(newLevelActor<Food>(object.x, object.y));
+        else
+            insertActor(newLevelActor<Dirt>(object.x, object.y));
     }
-    
-    // Creates a random number of food objects for the current level
-    int nFood = min(5 * L, 25);
-    for (int i = 0; i < nFood; i++) {
-        Food* food = nullptr;
-        bool overlap = false;
-        // Make sure food objects do not overlap with pits or other food
-        do {
-            getRandomPoint(x, y);
-            food = new Food(this, x, y);
-            list<Actor*> overlaps;
-            overlap = false;
-            getOverlap(food, overlaps, 2*SPRITE_RADIUS);
-            for (list<Actor*>::iterator p = overlaps.begin(); p != overlaps.end(); p++) {
-                if ((*p)->objectType() == ID_PIT || (*p)->objectType() == ID_FOOD) {
-                    overlap = true;
-                    delete food;
-                }
-            }
-        } while (overlap);
-        if (food != nullptr)
-            m_actors.push_back(food);
-    }
-
-    // Creates a random number of dirt piles for the current level
-    int nDirtObjects = max(180 - 20 * L, 20);
-    for (int i = 0; i < nDirtObjects; i++) {
-        Dirt* dirt = nullptr;
-        bool overlap = false;
-        // Make sure dirt piles do not overlap with pits or food
-        do {
-            getRandomPoint(x, y);
-            dirt = new Dirt(this, x, y);
-            list<Actor*> overlaps;
-            overlap = false;
-            getOverlap(dirt, overlaps, 2*SPRITE_RADIUS);
-            for (list<Actor*>::iterator p = overlaps.begin(); p != overlaps.end(); p++) {
-                if ((*p)->objectType() == ID_PIT || (*p)->objectType() == ID_FOOD) {
-                    overlap = true;
-                    delete dirt;
-                }
-            }
-        } while (overlap);
-        if (dirt != nullptr)
-            m_actors.push_back(dirt);
+    if (m_pregenerateLevels) {
+        m_layoutRandom = layout.random;
+        prepareLayouts();
     }
+    else
+        m_random = layout.random;
     
+    if (m_rewind != nullptr)
+        m_rewind->startLevel(*this);
+    publishFrame();
     return GWSTATUS_CONTINUE_GAME;
 }
 
-// Lets each active actor in the current tik of the game do something
+// Initializes a dish that holds only the player, so that benchmarks can populate it themselves
+void StudentWorld::initEmptyDish() {
+    if (m_arena == nullptr)
+        m_arena = make_shared<LevelArena>(m_arenaHighWater);
+    m_player = newLevelActor<Socrates>(0, dishCenterY());
+    m_player->setId(0);
+    m_nextActorId = 1;
+    m_ticks = 0;
+    m_pits = 0;
+}
+
+// Play the next tick, or the next few back to back when fast-forward is on
 int StudentWorld::move()
+{
+    if (m_ticksPerMove <= 1)
+        return playTick(true);
+    int ticksPlayed;
+    return fastForward(m_ticksPerMove, ticksPlayed);
+}
+
+// Lets each active actor in the current tik of the game do something, updating the game text at its end if asked to
+int StudentWorld::playTick(bool updateText)
 {
     int L = getLevel();
+    chrono::steady_clock::time_point tickStart;
+    if (m_telemetry != nullptr)
+        tickStart = chrono::steady_clock::now();
+    
+    m_ticks++;
+    m_inTick = true;
+    m_aiBudgetUsed = 0;
+    m_tickKeyPressed = false;
     
     // Allow player to do something, according to user input
+    enterPhase(PHASE_PLAYER);
+    double playerX = m_player->getX();
+    double playerY = m_player->getY();
     m_player->doSomething();
+    if (m_player->getX() != playerX || m_player->getY() != playerY)
+        m_playerMoves++;
  
-    // Loop through actors in the game and allow them to do something if they are active
-    for (list<Actor*>::iterator p = m_actors.begin(); p != m_actors.end(); p++) {
-        if ((*p)->isActive())
-            (*p)->doSomething();
-        if (!(m_player->isActive())) {
-            decLives();
-            return GWSTATUS_PLAYER_DIED;
-        }
-        // Checks how many bacteria are left in the game
-        bool zeroBacteria = true;
-        for (list<Actor*>::iterator p = m_actors.begin(); p != m_actors.end(); p++) {
-            int type = (*p)->objectType();
-            if (type == ID_REGULAR_SALMONELLA || type == ID_AGGRESSIVE_SALMONELLA || type == ID_ECOLI)
-                zeroBacteria = false;
-        }
-        // If there are no more bacteria or pits, the level is finished
-        if (zeroBacteria && m_pits == 0)
-            return GWSTATUS_FINISHED_LEVEL;
+    // Let every actor do something, using the selected engine
+    int status = (m_engine == ENGINE_REFERENCE) ? updateActorsReference() : updateActorsOptimized();
+    if (status != GWSTATUS_CONTINUE_GAME) {
+        commitSpawns();
+        if (m_profiler != nullptr)
+            m_profiler->endTick();
+        if (m_telemetry != nullptr)
+            recordTelemetry(status, chrono::duration<float, micro>(chrono::steady_clock::now() - tickStart).count());
+        if (m_rewind != nullptr)
+            m_rewind->recordTick(*this, m_tickKeyPressed, m_tickKey);
+        if (m_queryProfiler != nullptr)
+            m_queryProfiler->endTick(*this);
+        if (updateText)
+            publishFrame();
+        return status;
     }
     
     // The game must get rid of all actors that are not active
-    for (list<Actor*>::iterator p = m_actors.begin(); p != m_actors.end(); p++) {
-        if (!((*p)->isActive())) {
-            delete *p;
-            m_actors.erase(p);
-        }
-    }
+    enterPhase(PHASE_CLEANUP);
+    removeInactiveActors();
     
     // Potentially introduce a new fungus object into the current level
-    int chanceFungus = max(510 - L * 10, 200);
+    enterPhase(PHASE_SPAWNING);
+    int chanceFungus = m_config.fungusChance(L);
     int fungusActivation = randInt(0, chanceFungus);
     if (fungusActivation == 0) {
         double angle = randInt(1, 360) * M_PI / 180;
-        double x = cos(angle) * VIEW_RADIUS + VIEW_WIDTH/2;
-        double y = sin(angle) * VIEW_RADIUS + VIEW_HEIGHT/2;
-        m_actors.push_back(new Fungus(this, x, y));
+        double x = cos(angle) * dishRadius() + dishCenterX();
+        double y = sin(angle) * dishRadius() + dishCenterY();
+        addActor(new Fungus(this, x, y));
     }
     
     // Potentially introduce a new goodie object into the current level
-    int chanceGoodie = max(510 - L * 10, 250);
+    int chanceGoodie = m_config.goodieChance(L);
     int goodieActivation = randInt(0, chanceGoodie);
     if (goodieActivation == 0) {
         int angle = randInt(1, 360) * M_PI / 180;
-        double x = cos(angle) * VIEW_RADIUS + VIEW_WIDTH/2;
-        double y = sin(angle) * VIEW_RADIUS + VIEW_HEIGHT/2;
+        double x = cos(angle) * dishRadius() + dishCenterX();
+        double y = sin(angle) * dishRadius() + dishCenterY();
         
-        // Randomize which type of goodie will be added
-        int whichGoodie = randInt(1, 10);
-        if (whichGoodie == 1)
-            m_actors.push_back(new LifeGoodie(this, x, y));
-        else if (whichGoodie <= 4)
-            m_actors.push_back(new FTGoodie(this, x, y));
+        // Randomize which type of goodie will be added, in proportion to the weights of the configuration
+        int lifeWeight = m_config.lifeGoodieWeight;
+        int flameWeight = m_config.flameGoodieWeight;
+        int whichGoodie = randInt(1, lifeWeight + flameWeight + m_config.healthGoodieWeight);
+        if (whichGoodie <= lifeWeight)
+            addActor(new LifeGoodie(this, x, y));
+        else if (whichGoodie <= lifeWeight + flameWeight)
+            addActor(new FTGoodie(this, x, y));
         else
-            m_actors.push_back(new HealthGoodie(this, x, y));
+            addActor(new HealthGoodie(this, x, y));
+    }
+    
+    // Everything spawned during this tick joins the level now, so newborns first act in the next tick
+    commitSpawns();
+    
+    // Sort the records back into Morton order once actors have moved and spawned too far out of it
+    if (m_engine == ENGINE_OPTIMIZED && m_spatialReordering && m_ticks % REORDER_CHECK_INTERVAL == 0) {
+        enterPhase(PHASE_CLEANUP);
+        reorderRecords();
     }
     
     // Update the game text that will be presented to the user at the top of the screen
-    ostringstream text;
-    text.fill('0');
-    text << "Score: " << setw(6) << getScore() << "  Level: " << L << "  Lives: " << getLives() << "  Health: " << setw(1) << player()->hitPoints() << "  Sprays: " << setw(1) << m_player->sprays() << "  Flames: " << setw(1) << m_player->ftCharges();
-    string gameText = text.str();
-    setGameStatText(gameText);
+    enterPhase(PHASE_HUD);
+    if (updateText) {
+        updateGameText();
+        publishFrame();
+    }
+    if (m_profiler != nullptr)
+        m_profiler->endTick();
+    if (m_telemetry != nullptr)
+        recordTelemetry(GWSTATUS_CONTINUE_GAME, chrono::duration<float, micro>(chrono::steady_clock::now() - tickStart).count());
+    if (m_rewind != nullptr)
+        m_rewind->recordTick(*this, m_tickKeyPressed, m_tickKey);
+    if (m_queryProfiler != nullptr)
+        m_queryProfiler->endTick(*this);
         
     return GWSTATUS_CONTINUE_GAME;
 }
 
+// Update the text at the top of the screen, headless worlds have none
+void StudentWorld::updateGameText() {
+    if (m_headless)
+        return;
+    AllocationScope scope(ALLOC_HUD);
+    char gameText[128];
+    snprintf(gameText, sizeof(gameText), "Score: %06u  Level: %d  Lives: %u  Health: %d  Sprays: %d  Flames: %d",
+             getScore(), getLevel(), getLives(), player()->hitPoints(), m_player->sprays(), m_player->ftCharges());
+    setGameStatText(gameText);
+}
+
+// Hand the display a frame of the tick that just ended, if there is a render buffer
+void StudentWorld::publishFrame() {
+    if (m_render == nullptr)
+        return;
+    renderFrame(m_render->backFrame());
+    m_render->publish();
+}
+
+// Play up to the given number of ticks back to back, jumping over quiet stretches, and stop early after a tick that
+// ends the level. Returns the status of the last tick played
+int StudentWorld::fastForward(int ticks, int& ticksPlayed) {
+    ticksPlayed = 0;
+    int status = GWSTATUS_CONTINUE_GAME;
+    while (ticksPlayed < ticks && status == GWSTATUS_CONTINUE_GAME) {
+        ticksPlayed += jumpQuietTicks(ticks - ticksPlayed);
+        if (ticksPlayed < ticks) {
+            status = playTick(ticksPlayed == ticks - 1);
+            ticksPlayed++;
+        }
+        else {
+            updateGameText();
+            publishFrame();
+        }
+    }
+    return status;
+}
+
+// Jump over the coming ticks in which nothing would happen but item lifetimes running down and the player's sprays
+// recharging, at most maxTicks of them, and return how many were jumped
+// The rolls of each tick are drawn from a copy of the generator in the order the pits, fungus and goodie draw them, and
+// the player's input is read, until a roll comes up or a key is pressed. The world's generator is then moved past the
+// rolls of the jumped ticks only, and a key read is kept for the tick that is played next
+int StudentWorld::jumpQuietTicks(int maxTicks) {
+    // Per tick profiles, telemetry, rewind history and query heatmaps need every tick played
+    if (m_bacteria > 0 || m_pits == 0 || !m_spawns.empty() || !m_player->isActive() || m_profiler != nullptr || m_telemetry != nullptr || m_rewind != nullptr
+        || m_queryProfiler != nullptr)
+        return 0;
+    int window = maxTicks;
+    int pits = 0;
+    for (size_t i = 0; i < m_records.size(); i++) {
+        const ActorRecord& record = m_records[i];
+        int type = record.flags & FLAG_TYPE_MASK;
+        if (!(record.flags & FLAG_ACTIVE) || !hasType(MASK_STATIC | MASK_ITEMS, type))
+            return 0;
+        if (type == ID_PIT) {
+            if (static_cast<Pit*>(record.actor)->isEmpty())
+                return 0;
+            pits++;
+        }
+        // The tick an item is picked up or runs out is played in full
+        else if (hasType(MASK_ITEMS, type)) {
+            Item* item = static_cast<Item*>(record.actor);
+            if (isOverlap(item, m_player, SPRITE_WIDTH))
+                return 0;
+            window = min(window, item->lifeTime() - 1);
+        }
+    }
+    
+    int chanceFungus = m_config.fungusChance(getLevel());
+    int chanceGoodie = m_config.goodieChance(getLevel());
+    CountingRandom probe(m_random);
+    unsigned long long draws = 0;
+    int jumped = 0;
+    while (jumped < window) {
+        bool rolled = false;
+        for (int p = 0; p < pits && !rolled; p++)
+            rolled = (rollInt(probe, 1, 50) == 1);
+        if (rolled || rollInt(probe, 0, chanceFungus) == 0 || rollInt(probe, 0, chanceGoodie) == 0)
+            break;
+        
+        // The player's turn of the tick, with the key it reads kept for it
+        m_ticks++;
+        m_pendingKeyPressed = getKey(m_pendingKey);
+        m_keyPending = true;
+        if (m_pendingKeyPressed) {
+            m_ticks--;
+            break;
+        }
+        m_player->doSomething();
+        draws = probe.draws();
+        jumped++;
+    }
+    if (jumped == 0)
+        return 0;
+    
+    m_random.discard(draws);
+    for (size_t i = 0; i < m_records.size(); i++) {
+        if (hasType(MASK_ITEMS, m_records[i].flags & FLAG_TYPE_MASK)) {
+            Actor* item = (m_records[i].flags & FLAG_SHARED) ? ownActor((int) i) : m_records[i].actor;
+            static_cast<Item*>(item)->age(jumped);
+        }
+    }
+    // Nothing moved, so one check stands in for the reordering checks of every tick jumped
+    if (m_engine == ENGINE_OPTIMIZED && m_spatialReordering && m_ticks / REORDER_CHECK_INTERVAL != (m_ticks - jumped) / REORDER_CHECK_INTERVAL)
+        reorderRecords();
+    m_jumpedTicks += jumped;
+    return jumped;
+}
+
 // Called at the end of each completed level, so that the next level can build off scratch
 void StudentWorld::cleanUp()
 {
     // Delete the player
     if (m_player != nullptr)
-        delete m_player;
+        Actor::destroy(m_player);
     m_player = nullptr;
-    // Delete all other actors
+    // Delete all other actors, the records always point at the current ones
+    for (size_t i = 0; i < m_records.size(); i++)
+        releaseActor(m_records[i]);
+    m_actors.clear();
+    m_records.clear();
+    m_idOrder.clear();
+    m_pages.clear();
+    m_pageUse.clear();
+    // Delete actors that were spawned but never joined the level
+    for (size_t i = 0; i < m_spawns.size(); i++)
+        delete m_spawns[i];
+    m_spawns.clear();
+    // Take back the memory of the level's long-lived actors in one go, unless forks still have some of them on
+    // their pages, and start the next level with a block as big as this one needed
+    if (m_arena != nullptr) {
+        if (m_arena->used() > 0)
+            m_arenaHighWater = m_arena->used();
+        if (m_arena.use_count() == 1)
+            m_arena->reset(m_arenaHighWater);
+        else
+            m_arena.reset();
+    }
+    m_bacteria = 0;
+    m_staticCellsValid = false;
+}
+
+// Reference engine: loop through actors in the game and allow them to do something if they are active
+// After every actor, the whole list is rescanned to see whether any bacteria are left
+int StudentWorld::updateActorsReference() {
     for (list<Actor*>::iterator p = m_actors.begin(); p != m_actors.end(); p++) {
-        if (*p != nullptr)
-            delete *p;
-        m_actors.erase(p);
+        if ((*p)->isActive()) {
+            if (m_profiler != nullptr)
+                enterPhase(actorPhase((*p)->objectType()));
+            (*p)->doSomething();
+        }
+        if (!(m_player->isActive())) {
+            decLives();
+            return GWSTATUS_PLAYER_DIED;
+        }
+        // Checks how many bacteria are left in the game
+        bool zeroBacteria = true;
+        for (list<Actor*>::iterator p = m_actors.begin(); p != m_actors.end(); p++) {
+            int type = (*p)->objectType();
+            if (type == ID_REGULAR_SALMONELLA || type == ID_AGGRESSIVE_SALMONELLA || type == ID_ECOLI)
+                zeroBacteria = false;
+        }
+        // If there are no more bacteria or pits, the level is finished
+        if (zeroBacteria && m_pits == 0)
+            return GWSTATUS_FINISHED_LEVEL;
+    }
+    return GWSTATUS_CONTINUE_GAME;
+}
+
+// Optimized engine: same as the reference engine, but the number of bacteria in the list is kept as a running count
+// and the contacts between actors are found once up front by the broadphase
+// Actors are visited through their records in list order, the records never grow during the update phase
+int StudentWorld::updateActorsOptimized() {
+    enterPhase(PHASE_BROADPHASE);
+    buildContacts();
+    for (size_t k = 0; k < m_idOrder.size(); k++) {
+        int i = m_idOrder[k];
+        Actor* actor = m_records[i].actor;
+        if (actor->isActive()) {
+            // Dirt and food do nothing on their own, anything else shared with a fork is copied before it acts
+            if ((m_records[i].flags & FLAG_SHARED) && !hasType(MASK_INERT, actor->objectType()))
+                actor = ownActor(i);
+            if (m_profiler != nullptr)
+                enterPhase(actorPhase(actor->objectType()));
+            actor->doSomething();
+        }
+        if (!(m_player->isActive())) {
+            decLives();
+            m_contactsValid = false;
+            return GWSTATUS_PLAYER_DIED;
+        }
+        // If there are no more bacteria or pits, the level is finished
+        if (m_bacteria == 0 && m_pits == 0) {
+            m_contactsValid = false;
+            return GWSTATUS_FINISHED_LEVEL;
+        }
+    }
+    m_contactsValid = false;
+    return GWSTATUS_CONTINUE_GAME;
+}
+
+// Bucket every record into a grid with cells as wide as the broadphase reach, then pair each projectile,
+// bacterium and item with the actors in its own and neighboring cells that it could touch this tick
+void StudentWorld::buildContacts() {
+    AllocationScope scope(ALLOC_ENGINE);
+    // The grid spans the dish, actors past its edges go in the border cells
+    const double reach = SPRITE_WIDTH + m_broadphaseMargin;
+    const int columns = (int) (2 * dishRadius() / reach) + 1;
+    const int rows = columns;
+    
+    // Counting sort of the records by cell
+    int numberOfRecords = (int) m_records.size();
+    m_cellOf.resize(numberOfRecords);
+    m_cellStart.assign(columns * rows + 1, 0);
+    for (int i = 0; i < numberOfRecords; i++) {
+        int column = min(max((int) (m_records[i].x / reach), 0), columns - 1);
+        int row = min(max((int) (m_records[i].y / reach), 0), rows - 1);
+        m_cellOf[i] = row * columns + column;
+        m_cellStart[m_cellOf[i] + 1]++;
+    }
+    for (int c = 0; c < columns * rows; c++)
+        m_cellStart[c + 1] += m_cellStart[c];
+    m_cellRecords.resize(numberOfRecords);
+    m_cellFill.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+    for (int i = 0; i < numberOfRecords; i++)
+        m_cellRecords[m_cellFill[m_cellOf[i]]++] = i;
+    
+    // Emit the candidate pairs of every active subject, grouped by subject and ordered by target id
+    float reachSquared = (float) ((reach + RECORD_POSITION_SLACK) * (reach + RECORD_POSITION_SLACK));
+    float playerX = (float) m_player->getX();
+    float playerY = (float) m_player->getY();
+    m_contactStart.assign(numberOfRecords + 1, 0);
+    m_nearPlayer.assign(numberOfRecords, 0);
+    m_contactTargets.clear();
+    // Contacts rarely outnumber the records twice over, room for that keeps the buffer from growing while the population holds
+    if (m_contactTargets.capacity() < 2 * (size_t) numberOfRecords)
+        m_contactTargets.reserve(2 * numberOfRecords);
+    for (int i = 0; i < numberOfRecords; i++) {
+        const ActorRecord& subject = m_records[i];
+        m_contactStart[i] = (int) m_contactTargets.size();
+        unsigned int subjectType = typeMask(subject.flags & FLAG_TYPE_MASK);
+        if (!(subject.flags & FLAG_ACTIVE) || !(subjectType & (MASK_PROJECTILES | MASK_BACTERIA | MASK_ITEMS)))
+            continue;
+        
+        // Bacteria and items can touch the player, projectiles pass it by
+        if (subjectType & (MASK_BACTERIA | MASK_ITEMS)) {
+            float dx = playerX - subject.x;
+            float dy = playerY - subject.y;
+            m_nearPlayer[i] = (dx*dx + dy*dy <= reachSquared);
+        }
+        
+        unsigned int targets = broadphaseTargets(subject.flags & FLAG_TYPE_MASK);
+        if (targets == 0)
+            continue;
+        int column = m_cellOf[i] % columns;
+        int row = m_cellOf[i] / columns;
+        for (int r = max(row - 1, 0); r <= min(row + 1, rows - 1); r++) {
+            for (int c = max(column - 1, 0); c <= min(column + 1, columns - 1); c++) {
+                for (int k = m_cellStart[r * columns + c]; k < m_cellStart[r * columns + c + 1]; k++) {
+                    const ActorRecord& target = m_records[m_cellRecords[k]];
+                    if (!(typeMask(target.flags & FLAG_TYPE_MASK) & targets) || m_cellRecords[k] == i)
+                        continue;
+                    float dx = target.x - subject.x;
+                    float dy = target.y - subject.y;
+                    if (dx*dx + dy*dy <= reachSquared)
+                        m_contactTargets.push_back(m_cellRecords[k]);
+                }
+            }
+        }
+        // Queries find the first or last contact in list order, which is id order
+        sort(m_contactTargets.begin() + m_contactStart[i], m_contactTargets.end(), [this](int a, int b) { return m_records[a].id < m_records[b].id; });
+    }
+    m_contactStart[numberOfRecords] = (int) m_contactTargets.size();
+    m_contactsValid = true;
+}
+
+// Return the types of actor the broadphase pairs an actor of a given type with, apart from the player
+// Pits, food and dirt are never paired, contacts with them are looked up in the static grid
+unsigned int StudentWorld::broadphaseTargets(int objectType) const {
+    if (hasType(MASK_PROJECTILES, objectType))
+        return MASK_BACTERIA | MASK_ITEMS;
+    return 0;
+}
+
+// Check whether any actor of the given types overlaps an actor
+bool StudentWorld::anyOverlap(Actor* actor, unsigned int types, double radius) {
+    return forEachOverlap(actor, types, radius, [](Actor*) { return false; });
+}
+
+// Hand the overlapping actors of the given types to a visitor in getOverlap's order, from the broadphase contacts when
+// they cover the query and from a scan of the records otherwise, then the player
+bool StudentWorld::visitOverlaps(Actor* actor, unsigned int types, double radius, OverlapVisitor visit, void* context) {
+    QueryRecord query(m_queryProfiler, QUERY_OVERLAPS, actor->getX(), actor->getY(), radius);
+    int record = actor->record();
+    if (m_engine == ENGINE_REFERENCE) {
+        for (list<Actor*>::iterator p = m_actors.begin(); p != m_actors.end(); p++) {
+            query.examined++;
+            if (*p != actor && hasType(types, (*p)->objectType()) && isOverlap(actor, *p, radius) && (query.hits++, !visit(*p, context)))
+                return true;
+        }
+    }
+    else if (m_contactsValid && record >= 0 && radius <= SPRITE_WIDTH
+             && (types & ~(broadphaseTargets(m_records[record].flags & FLAG_TYPE_MASK) | typeMask(ID_SOCRATES))) == 0) {
+        for (int k = m_contactStart[record]; k < m_contactStart[record + 1]; k++) {
+            const ActorRecord& target = m_records[m_contactTargets[k]];
+            query.examined++;
+            if (hasType(types, target.flags & FLAG_TYPE_MASK) && isOverlap(actor, target.actor, radius) && (query.hits++, !visit(target.actor, context)))
+                return true;
+        }
+    }
+    else {
+        float x = (float) actor->getX();
+        float y = (float) actor->getY();
+        float reach = (float) (radius + RECORD_POSITION_SLACK);
+        for (size_t k = 0; k < m_idOrder.size(); k++) {
+            const ActorRecord& candidate = m_records[m_idOrder[k]];
+            query.examined++;
+            if (!hasType(types, candidate.flags & FLAG_TYPE_MASK) || candidate.actor == actor)
+                continue;
+            float dx = candidate.x - x;
+            float dy = candidate.y - y;
+            if (dx*dx + dy*dy <= reach * reach && isOverlap(actor, candidate.actor, radius) && (query.hits++, !visit(candidate.actor, context)))
+                return true;
+        }
+    }
+    // getOverlap lists the player after every other actor
+    return hasType(types, ID_SOCRATES) && actor != m_player && isOverlap(actor, m_player, radius) && (query.hits++, !visit(m_player, context));
+}
+
+// Get the first actor of the given types that overlaps a projectile or bacterium
+Actor* StudentWorld::firstContact(Actor* actor, unsigned int types, double radius) {
+    return findContact(actor, types, radius, false, QUERY_PROJECTILE_HITS);
+}
+
+// Get the last actor of the given types that overlaps a projectile or bacterium
+Actor* StudentWorld::lastContact(Actor* actor, unsigned int types, double radius) {
+    return findContact(actor, types, radius, true, QUERY_FOOD_CONTACTS);
+}
+
+// Find the first or last overlapping actor of the given types in getOverlap's order, from the broadphase contacts and
+// the static grid when they cover the query. The exact test runs against current positions, so actors that moved since
+// the broadphase are handled correctly. The caller may change the actor it gets back, so one shared with a fork is copied first
+// The query is charged to the given call site
+Actor* StudentWorld::findContact(Actor* actor, unsigned int types, double radius, bool last, int site) {
+    QueryRecord query(m_queryProfiler, site, actor->getX(), actor->getY(), radius);
+    int record = actor->record();
+    int found = -1;
+    Actor* foundActor = nullptr;
+    unsigned int covered = (record >= 0) ? broadphaseTargets(m_records[record].flags & FLAG_TYPE_MASK) | typeMask(ID_SOCRATES) | MASK_STATIC : 0;
+    if (m_contactsValid && record >= 0 && radius <= SPRITE_WIDTH && (types & ~covered) == 0) {
+        for (int k = m_contactStart[record]; k < m_contactStart[record + 1]; k++) {
+            int target = m_contactTargets[k];
+            query.examined++;
+            if ((typeMask(m_records[target].flags & FLAG_TYPE_MASK) & types) && isOverlap(actor, m_records[target].actor, radius)) {
+                found = target;
+                if (!last)
+                    break;
+            }
+        }
+        // Both answers are the first or last in id order, so the answer is whichever of them comes first, or last
+        if (types & MASK_STATIC) {
+            int staticFound = staticContact(actor, types & MASK_STATIC, radius, last, query.examined);
+            if (staticFound >= 0 && (found < 0 || (last ? m_records[staticFound].id > m_records[found].id : m_records[staticFound].id < m_records[found].id)))
+                found = staticFound;
+        }
+    }
+    else if (m_engine == ENGINE_REFERENCE) {
+        for (list<Actor*>::iterator p = m_actors.begin(); p != m_actors.end(); p++) {
+            query.examined++;
+            if (*p != actor && (typeMask((*p)->objectType()) & types) && isOverlap(actor, *p, radius)) {
+                foundActor = *p;
+                if (!last)
+                    break;
+            }
+        }
+    }
+    else {
+        float x = (float) actor->getX();
+        float y = (float) actor->getY();
+        float reach = (float) (radius + RECORD_POSITION_SLACK);
+        for (size_t k = 0; k < m_idOrder.size(); k++) {
+            const ActorRecord& candidate = m_records[m_idOrder[k]];
+            query.examined++;
+            if (!(typeMask(candidate.flags & FLAG_TYPE_MASK) & types) || candidate.actor == actor)
+                continue;
+            float dx = candidate.x - x;
+            float dy = candidate.y - y;
+            if (dx*dx + dy*dy <= reach * reach && isOverlap(actor, candidate.actor, radius)) {
+                found = m_idOrder[k];
+                if (!last)
+                    break;
+            }
+        }
+    }
+    if (found >= 0)
+        foundActor = ownActor(found);
+    
+    // getOverlap lists the player after every other actor
+    if ((types & typeMask(ID_SOCRATES)) && (last || foundActor == nullptr) && actor != m_player && isOverlap(actor, m_player, radius))
+        foundActor = m_player;
+    query.hits = (foundActor != nullptr);
+    return foundActor;
+}
+
+// Check whether any dirt pile, active or not, is within a radius of a point
+// The same test getOverlap makes for an actor standing at the point, without creating one
+bool StudentWorld::isDirtAt(double x, double y, double radius) const {
+    return findAnyAt(x, y, typeMask(ID_DIRT), radius, QUERY_DIRT_CHECKS);
+}
+
+// Check whether any actor of the given types, active or not, is within a radius of a point
+bool StudentWorld::isAnyAt(double x, double y, unsigned int types, double radius) const {
+    return findAnyAt(x, y, types, radius, QUERY_POINTS);
+}
+
+// Check whether any actor of the given types is within a radius of a point, charging the query to a call site
+bool StudentWorld::findAnyAt(double x, double y, unsigned int types, double radius, int site) const {
+    QueryRecord query(m_queryProfiler, site, x, y, radius);
+    if (m_engine == ENGINE_REFERENCE) {
+        for (list<Actor*>::const_iterator p = m_actors.begin(); p != m_actors.end(); p++) {
+            query.examined++;
+            if ((typeMask((*p)->objectType()) & types) && pointsOverlap(x, y, (*p)->getX(), (*p)->getY(), radius)) {
+                query.hits = 1;
+                return true;
+            }
+        }
+        return false;
+    }
+    float reach = (float) (radius + RECORD_POSITION_SLACK);
+    
+    // Anything that moves is only found by scanning every record
+    if (types & ~MASK_STATIC) {
+        for (size_t i = 0; i < m_records.size(); i++) {
+            const ActorRecord& record = m_records[i];
+            query.examined++;
+            if (!(typeMask(record.flags & FLAG_TYPE_MASK) & types))
+                continue;
+            float dx = record.x - (float) x;
+            float dy = record.y - (float) y;
+            if (dx*dx + dy*dy <= reach * reach && pointsOverlap(x, y, record.actor->getX(), record.actor->getY(), radius)) {
+                query.hits = 1;
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    // Pits, food and dirt are only looked for in the cells the radius reaches into
+    buildStaticCells();
+    int firstColumn;
+    int firstRow;
+    int lastColumn;
+    int lastRow;
+    staticCell(x - reach, y - reach, firstColumn, firstRow);
+    staticCell(x + reach, y + reach, lastColumn, lastRow);
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            const vector<int>& cell = m_staticCells[row * m_staticColumns + column];
+            for (size_t k = 0; k < cell.size(); k++) {
+                const ActorRecord& record = m_records[cell[k]];
+                query.examined++;
+                if (!(typeMask(record.flags & FLAG_TYPE_MASK) & types))
+                    continue;
+                float dx = record.x - (float) x;
+                float dy = record.y - (float) y;
+                if (dx*dx + dy*dy <= reach * reach && pointsOverlap(x, y, record.actor->getX(), record.actor->getY(), radius)) {
+                    query.hits = 1;
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Find the nearest actor of a type that is closer to a given actor than maxDistance, the first one in list order on a tie
+Actor* StudentWorld::nearestActor(Actor* actor, int objectType, double maxDistance) const {
+    double x = actor->getX();
+    double y = actor->getY();
+    QueryRecord query(m_queryProfiler, QUERY_FOOD_SEARCH, x, y, maxDistance);
+    Actor* nearest = nullptr;
+    double nearestDistance = maxDistance;
+    if (m_engine == ENGINE_REFERENCE) {
+        for (list<Actor*>::const_iterator p = m_actors.begin(); p != m_actors.end(); p++) {
+            query.examined++;
+            if (*p == actor || (*p)->objectType() != objectType)
+                continue;
+            double dx = (*p)->getX() - x;
+            double dy = (*p)->getY() - y;
+            double distance = sqrt(dx*dx + dy*dy);
+            if (distance < nearestDistance) {
+                nearest = *p;
+                nearestDistance = distance;
+            }
+        }
+        query.hits = (nearest != nullptr);
+        return nearest;
+    }
+    float reach = (float) (maxDistance + RECORD_POSITION_SLACK);
+    if (!isStatic(objectType)) {
+        for (size_t k = 0; k < m_idOrder.size(); k++) {
+            const ActorRecord& record = m_records[m_idOrder[k]];
+            query.examined++;
+            if ((int) (record.flags & FLAG_TYPE_MASK) != objectType || record.actor == actor)
+                continue;
+            float fx = record.x - (float) x;
+            float fy = record.y - (float) y;
+            if (fx*fx + fy*fy > reach * reach)
+                continue;
+            double dx = record.actor->getX() - x;
+            double dy = record.actor->getY() - y;
+            double distance = sqrt(dx*dx + dy*dy);
+            if (distance < nearestDistance) {
+                nearest = record.actor;
+                nearestDistance = distance;
+            }
+        }
+        query.hits = (nearest != nullptr);
+        return nearest;
+    }
+    
+    // Search the static grid in square rings around the actor's cell. Everything in ring k + 1 and beyond is at
+    // least k cells away, so the search stops once that is further than the nearest actor found so far
+    // Ties go to the lowest id, which is the first one in list order
+    buildStaticCells();
+    int column;
+    int row;
+    staticCell(x, y, column, row);
+    int nearestId = -1;
+    int rings = (int) (reach / STATIC_GRID_CELL) + 1;
+    for (int ring = 0; ring <= rings; ring++) {
+        for (int r = max(row - ring, 0); r <= min(row + ring, m_staticColumns - 1); r++) {
+            // Inner rows of the ring only have its leftmost and rightmost cell
+            int step = (r == row - ring || r == row + ring) ? 1 : 2 * ring;
+            for (int c = column - ring; c <= column + ring; c += step) {
+                if (c < 0 || c >= m_staticColumns)
+                    continue;
+                const vector<int>& cell = m_staticCells[r * m_staticColumns + c];
+                for (size_t k = 0; k < cell.size(); k++) {
+                    const ActorRecord& record = m_records[cell[k]];
+                    query.examined++;
+                    if ((int) (record.flags & FLAG_TYPE_MASK) != objectType || record.actor == actor)
+                        continue;
+                    float fx = record.x - (float) x;
+                    float fy = record.y - (float) y;
+                    if (fx*fx + fy*fy > reach * reach)
+                        continue;
+                    double dx = record.actor->getX() - x;
+                    double dy = record.actor->getY() - y;
+                    double distance = sqrt(dx*dx + dy*dy);
+                    if (distance < nearestDistance || (distance == nearestDistance && nearestId >= 0 && record.id < nearestId)) {
+                        nearest = record.actor;
+                        nearestDistance = distance;
+                        nearestId = record.id;
+                    }
+                }
+            }
+        }
+        if (nearest != nullptr && ring * STATIC_GRID_CELL - RECORD_POSITION_SLACK > nearestDistance)
+            break;
+    }
+    query.hits = (nearest != nullptr);
+    return nearest;
+}
+
+// Find the record of the first or last pit, food or dirt of the given types in id order that overlaps an actor, -1 if
+// there is none, adding the records looked at to a count
+int StudentWorld::staticContact(Actor* actor, unsigned int types, double radius, bool last, int& examined) const {
+    buildStaticCells();
+    double x = actor->getX();
+    double y = actor->getY();
+    float reach = (float) (radius + RECORD_POSITION_SLACK);
+    int firstColumn;
+    int firstRow;
+    int lastColumn;
+    int lastRow;
+    staticCell(x - reach, y - reach, firstColumn, firstRow);
+    staticCell(x + reach, y + reach, lastColumn, lastRow);
+    int found = -1;
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            const vector<int>& cell = m_staticCells[row * m_staticColumns + column];
+            for (size_t k = 0; k < cell.size(); k++) {
+                const ActorRecord& record = m_records[cell[k]];
+                examined++;
+                if (!(typeMask(record.flags & FLAG_TYPE_MASK) & types) || (found >= 0 && (last ? record.id < m_records[found].id : record.id > m_records[found].id)))
+                    continue;
+                float dx = record.x - (float) x;
+                float dy = record.y - (float) y;
+                if (dx*dx + dy*dy <= reach * reach && isOverlap(actor, record.actor, radius))
+                    found = cell[k];
+            }
+        }
+    }
+    return found;
+}
+
+// Cast a path of steps from a point and return the first step that could put an actor within a radius of pits, food or
+// dirt of the given types, or the number of steps if none could. Step k is k times stepLength away in a direction, as
+// far as moveForward would take an actor in k moves. Anything that could be within reach by rounding counts as a hit,
+// so the step returned is never later than the first step an overlap test would find an overlap at
+// The reference engine always returns 0, the static grid is part of the optimized engine
+int StudentWorld::firstStaticStep(double x, double y, int direction, double stepLength, int steps, unsigned int types, double radius) const {
+    QueryRecord query(m_queryProfiler, QUERY_PROJECTILE_PATHS, x, y, radius);
+    if (m_engine == ENGINE_REFERENCE || steps <= 0)
+        return 0;
+    buildStaticCells();
+    
+    // The same direction GraphObject::getPositionInThisDirection moves in
+    const double PI = 4 * atan(1.0);
+    double dx = cos(direction * 1.0 / 360 * 2 * PI);
+    double dy = sin(direction * 1.0 / 360 * 2 * PI);
+    double length = (steps - 1) * stepLength;
+    double reach = radius + RECORD_POSITION_SLACK;
+    int firstColumn;
+    int firstRow;
+    int lastColumn;
+    int lastRow;
+    staticCell(min(x, x + dx * length) - reach, min(y, y + dy * length) - reach, firstColumn, firstRow);
+    staticCell(max(x, x + dx * length) + reach, max(y, y + dy * length) + reach, lastColumn, lastRow);
+    
+    int first = steps;
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            const vector<int>& cell = m_staticCells[row * m_staticColumns + column];
+            for (size_t k = 0; k < cell.size(); k++) {
+                const ActorRecord& record = m_records[cell[k]];
+                query.examined++;
+                if (!(typeMask(record.flags & FLAG_TYPE_MASK) & types))
+                    continue;
+                // The path is within reach of the center for t in [t1, t2], where t solves |p + t*d - c| = reach
+                double fx = x - record.actor->getX();
+                double fy = y - record.actor->getY();
+                double b = fx*dx + fy*dy;
+                double discriminant = b*b - (fx*fx + fy*fy - reach*reach);
+                if (discriminant < 0)
+                    continue;
+                double t1 = -b - sqrt(discriminant);
+                double t2 = -b + sqrt(discriminant);
+                int step = max((int) ceil(t1 / stepLength), 0);
+                if (step * stepLength <= t2 && step < first)
+                    first = step;
+            }
+        }
+    }
+    query.hits = (first < steps);
+    return first;
+}
+
+// Return a number that changes whenever pits, food or dirt are added to the level
+int StudentWorld::staticVersion() const {
+    return m_staticVersion;
+}
+
+// Check whether an object type never moves, and so is kept in the static grid
+bool StudentWorld::isStatic(int objectType) const {
+    return hasType(MASK_STATIC, objectType);
+}
+
+// Find the static grid cell of a point, clamped to the grid, and return its index
+int StudentWorld::staticCell(double x, double y, int& column, int& row) const {
+    column = min(max((int) floor(x / STATIC_GRID_CELL), 0), m_staticColumns - 1);
+    row = min(max((int) floor(y / STATIC_GRID_CELL), 0), m_staticColumns - 1);
+    return row * m_staticColumns + column;
+}
+
+// Size the wake grid to the dish, waking every sleeping bacterium: each cell starts past the newest version there was
+void StudentWorld::resetWakeCells() {
+    int version = m_wakeVersions.empty() ? 0 : *max_element(m_wakeVersions.begin(), m_wakeVersions.end()) + 1;
+    m_wakeColumns = (int) (2 * dishRadius() / STATIC_GRID_CELL) + 1;
+    m_wakeVersions.assign(m_wakeColumns * m_wakeColumns, version);
+}
+
+// Dirt was added or removed at a point, wake the bacteria sleeping within a cell of it
+void StudentWorld::touchWakeCells(double x, double y) {
+    int column = min(max((int) floor(x / STATIC_GRID_CELL), 0), m_wakeColumns - 1);
+    int row = min(max((int) floor(y / STATIC_GRID_CELL), 0), m_wakeColumns - 1);
+    for (int r = max(row - 1, 0); r <= min(row + 1, m_wakeColumns - 1); r++) {
+        for (int c = max(column - 1, 0); c <= min(column + 1, m_wakeColumns - 1); c++)
+            m_wakeVersions[r * m_wakeColumns + c]++;
+    }
+}
+
+// Return the version of a point's region, bacteria only sleep under the optimized engine
+int StudentWorld::sleepVersion(double x, double y, bool watchPlayer) const {
+    if (m_engine == ENGINE_REFERENCE)
+        return -1;
+    int column = min(max((int) floor(x / STATIC_GRID_CELL), 0), m_wakeColumns - 1);
+    int row = min(max((int) floor(y / STATIC_GRID_CELL), 0), m_wakeColumns - 1);
+    return m_wakeVersions[row * m_wakeColumns + column] + (watchPlayer ? m_playerMoves : 0);
+}
+
+// Put every pit, food and dirt record in its cell of the static grid, if the records changed since the grid was built
+// The cells keep their room from one build to the next, so rebuilding them does not allocate while the level holds steady
+void StudentWorld::buildStaticCells() const {
+    if (m_staticCellsValid)
+        return;
+    AllocationScope scope(ALLOC_ENGINE);
+    m_staticColumns = (int) (2 * dishRadius() / STATIC_GRID_CELL) + 1;
+    m_staticCells.resize(m_staticColumns * m_staticColumns);
+    for (size_t c = 0; c < m_staticCells.size(); c++)
+        m_staticCells[c].clear();
+    int column;
+    int row;
+    for (size_t i = 0; i < m_records.size(); i++) {
+        if (isStatic(m_records[i].flags & FLAG_TYPE_MASK))
+            m_staticCells[staticCell(m_records[i].x, m_records[i].y, column, row)].push_back((int) i);
+    }
+    m_staticCellsValid = true;
+}
+
+// Check whether an actor overlaps the player, skipping the test when the broadphase ruled it out
+bool StudentWorld::overlapsPlayer(Actor* actor, double radius) {
+    QueryRecord query(m_queryProfiler, QUERY_PLAYER_CONTACTS, actor->getX(), actor->getY(), radius);
+    int record = actor->record();
+    if (m_contactsValid && record >= 0 && radius <= SPRITE_WIDTH && !m_nearPlayer[record])
+        return false;
+    query.examined = 1;
+    query.hits = isOverlap(actor, m_player, radius);
+    return query.hits != 0;
+}
+
+// Find the contacts of a ring of points around a center, as firstContact would for an actor standing at each of them
+// Every point lies between two distances of the center, so only the actors on the ring between them can touch any: the
+// others are read from the broadphase grid, widened by its margin since they may have moved after they were bucketed,
+// and pits, food and dirt from the static grid. Each point then takes the first of them in id order that it overlaps
+void StudentWorld::ringContacts(double centerX, double centerY, const RingPoint* points, int count, double radius, Actor** contacts) {
+    QueryRecord query(m_queryProfiler, QUERY_FLAME_BURSTS, centerX, centerY, radius);
+    if (m_engine == ENGINE_REFERENCE) {
+        for (int p = 0; p < count; p++) {
+            contacts[p] = nullptr;
+            for (list<Actor*>::iterator a = m_actors.begin(); a != m_actors.end(); a++) {
+                query.examined++;
+                if (hasType(points[p].types, (*a)->objectType()) && pointsOverlap(points[p].x, points[p].y, (*a)->getX(), (*a)->getY(), radius)) {
+                    contacts[p] = *a;
+                    query.hits++;
+                    break;
+                }
+            }
+        }
+        return;
+    }
+    
+    unsigned int types = 0;
+    double nearest = dishRadius() * 4;
+    double farthest = 0;
+    for (int p = 0; p < count; p++) {
+        double distance = sqrt((points[p].x - centerX) * (points[p].x - centerX) + (points[p].y - centerY) * (points[p].y - centerY));
+        nearest = min(nearest, distance);
+        farthest = max(farthest, distance);
+        types |= points[p].types;
+    }
+    float inner = (float) max(nearest - radius - RECORD_POSITION_SLACK, 0.0);
+    float outer = (float) (farthest + radius + RECORD_POSITION_SLACK);
+    float x = (float) centerX;
+    float y = (float) centerY;
+    auto onRing = [&](const ActorRecord& record) {
+        float dx = record.x - x;
+        float dy = record.y - y;
+        float distanceSquared = dx*dx + dy*dy;
+        return hasType(types, record.flags & FLAG_TYPE_MASK) && distanceSquared >= inner * inner && distanceSquared <= outer * outer;
+    };
+    
+    m_ringCandidates.clear();
+    if (types & ~MASK_STATIC) {
+        if (m_contactsValid) {
+            // The same grid buildContacts bucketed the records in
+            const double reach = SPRITE_WIDTH + m_broadphaseMargin;
+            const int columns = (int) (2 * dishRadius() / reach) + 1;
+            double bound = outer + m_broadphaseMargin;
+            int firstColumn = min(max((int) ((centerX - bound) / reach), 0), columns - 1);
+            int lastColumn = min(max((int) ((centerX + bound) / reach), 0), columns - 1);
+            int firstRow = min(max((int) ((centerY - bound) / reach), 0), columns - 1);
+            int lastRow = min(max((int) ((centerY + bound) / reach), 0), columns - 1);
+            for (int row = firstRow; row <= lastRow; row++) {
+                for (int column = firstColumn; column <= lastColumn; column++) {
+                    for (int k = m_cellStart[row * columns + column]; k < m_cellStart[row * columns + column + 1]; k++) {
+                        int i = m_cellRecords[k];
+                        query.examined++;
+                        if (!isStatic(m_records[i].flags & FLAG_TYPE_MASK) && onRing(m_records[i]))
+                            m_ringCandidates.push_back(i);
+                    }
+                }
+            }
+        }
+        else {
+            query.examined += (int) m_records.size();
+            for (size_t i = 0; i < m_records.size(); i++) {
+                if (!isStatic(m_records[i].flags & FLAG_TYPE_MASK) && onRing(m_records[i]))
+                    m_ringCandidates.push_back((int) i);
+            }
+        }
+    }
+    if (types & MASK_STATIC) {
+        buildStaticCells();
+        int firstColumn;
+        int firstRow;
+        int lastColumn;
+        int lastRow;
+        staticCell(centerX - outer, centerY - outer, firstColumn, firstRow);
+        staticCell(centerX + outer, centerY + outer, lastColumn, lastRow);
+        for (int row = firstRow; row <= lastRow; row++) {
+            for (int column = firstColumn; column <= lastColumn; column++) {
+                const vector<int>& cell = m_staticCells[row * m_staticColumns + column];
+                query.examined += (int) cell.size();
+                for (size_t k = 0; k < cell.size(); k++) {
+                    if (onRing(m_records[cell[k]]))
+                        m_ringCandidates.push_back(cell[k]);
+                }
+            }
+        }
+    }
+    sort(m_ringCandidates.begin(), m_ringCandidates.end(), [this](int a, int b) { return m_records[a].id < m_records[b].id; });
+    
+    for (int p = 0; p < count; p++) {
+        contacts[p] = nullptr;
+        for (size_t k = 0; k < m_ringCandidates.size(); k++) {
+            const ActorRecord& candidate = m_records[m_ringCandidates[k]];
+            if (hasType(points[p].types, candidate.flags & FLAG_TYPE_MASK)
+                && pointsOverlap(points[p].x, points[p].y, candidate.actor->getX(), candidate.actor->getY(), radius)) {
+                contacts[p] = ownActor(m_ringCandidates[k]);
+                query.hits++;
+                break;
+            }
+        }
     }
 }
 
 // Introduce a new actor into the level
+// Actors created during a tick wait in the spawn buffer until the update phase is over
 void StudentWorld::addActor(Actor* newActor) {
+    AllocationScope scope(ALLOC_ENGINE);
+    if (m_inTick)
+        m_spawns.push_back(newActor);
+    else
+        insertActor(newActor);
+}
+
+// Move every buffered spawn into the level in one batch and end the tick
+void StudentWorld::commitSpawns() {
+    AllocationScope scope(ALLOC_ENGINE);
+    m_inTick = false;
+    if (m_spawns.empty())
+        return;
+    size_t needed = m_records.size() + m_spawns.size();
+    if (needed > m_records.capacity())
+        reserveRecords(max(needed, 2 * m_records.capacity()));
+    for (size_t i = 0; i < m_spawns.size(); i++)
+        insertActor(m_spawns[i]);
+    m_spawns.clear();
+}
+
+// Give an actor its id and append it to the list of actors and to the actor records
+void StudentWorld::insertActor(Actor* newActor) {
+    AllocationScope scope(ALLOC_ENGINE);
+    newActor->setId(m_nextActorId);
+    m_nextActorId += newActor->idCount();
+    if (isBacteria(newActor->objectType()))
+        m_bacteria++;
     m_actors.push_back(newActor);
+    
+    ActorRecord record;
+    record.x = (float) newActor->getX();
+    record.y = (float) newActor->getY();
+    record.flags = newActor->flags();
+    record.id = newActor->id();
+    record.actor = newActor;
+    newActor->setRecord((int) m_records.size());
+    m_idOrder.push_back((int) m_records.size());
+    m_records.push_back(record);
+    // The buffers the records are sorted and compacted through grow along with them
+    if (m_recordBuffer.capacity() < m_records.capacity())
+        reserveRecords(m_records.capacity());
+    
+    // New records go at the end, so the static grid stays valid if they are added to their cells as they come
+    if (isStatic(newActor->objectType()))
+        m_staticVersion++;
+    if (newActor->objectType() == ID_DIRT)
+        touchWakeCells(newActor->getX(), newActor->getY());
+    if (m_staticCellsValid && isStatic(newActor->objectType())) {
+        int column;
+        int row;
+        m_staticCells[staticCell(record.x, record.y, column, row)].push_back(record.actor->record());
+    }
+}
+
+// Copy an actor's current position and flags into its record
+void StudentWorld::updateRecord(Actor* actor) {
+    ActorRecord& record = m_records[actor->record()];
+    record.x = (float) actor->getX();
+    record.y = (float) actor->getY();
+    record.flags = actor->flags();
+}
+
+// Drop inactive actors from the records, keeping the rest in the order they are in, then from the list and the id order
+// The list is brought back in line with the records, which point at the copies of any shared actors changed this tick
+void StudentWorld::removeInactiveActors() {
+    AllocationScope scope(ALLOC_ENGINE);
+    m_newIndex.resize(m_records.size());
+    size_t kept = 0;
+    for (size_t i = 0; i < m_records.size(); i++) {
+        const ActorRecord& record = m_records[i];
+        if (record.flags & FLAG_ACTIVE) {
+            if (kept != i) {
+                m_records[kept] = record;
+                if (!(record.flags & FLAG_SHARED))
+                    m_records[kept].actor->setRecord((int) kept);
+            }
+            m_newIndex[i] = (int) kept;
+            kept++;
+        }
+        else {
+            if (isBacteria(record.flags & FLAG_TYPE_MASK))
+                m_bacteria--;
+            else if ((record.flags & FLAG_TYPE_MASK) == ID_DIRT)
+                touchWakeCells(record.actor->getX(), record.actor->getY());
+            releaseActor(record);
+            m_newIndex[i] = -1;
+        }
+    }
+    if (kept == m_records.size()) {
+        // Nothing was dropped, but the list still has to point at the copies
+        list<Actor*>::iterator p = m_actors.begin();
+        for (size_t k = 0; k < m_idOrder.size(); k++, p++)
+            *p = m_records[m_idOrder[k]].actor;
+        return;
+    }
+    
+    // The list and the id order are both in id order, so they are walked together
+    list<Actor*>::iterator p = m_actors.begin();
+    size_t keptOrder = 0;
+    for (size_t k = 0; k < m_idOrder.size(); k++) {
+        int index = m_newIndex[m_idOrder[k]];
+        if (index >= 0) {
+            *p = m_records[index].actor;
+            p++;
+            m_idOrder[keptOrder++] = index;
+        }
+        else
+            p = m_actors.erase(p);
+    }
+    m_idOrder.resize(keptOrder);
+    // Compacting moved the records the static grid points at
+    m_staticCellsValid = false;
+    m_records.resize(kept);
+}
+
+// Return the Morton code of a position: the bits of its column and row on a 65536 wide grid over the dish, interleaved
+unsigned int StudentWorld::mortonCode(float x, float y) const {
+    const float scale = (float) (65535 / (2 * dishRadius()));
+    unsigned int column = (unsigned int) min(max(x * scale, 0.0f), 65535.0f);
+    unsigned int row = (unsigned int) min(max(y * scale, 0.0f), 65535.0f);
+    auto spread = [](unsigned int bits) {
+        bits = (bits | (bits << 8)) & 0x00ff00ff;
+        bits = (bits | (bits << 4)) & 0x0f0f0f0f;
+        bits = (bits | (bits << 2)) & 0x33333333;
+        bits = (bits | (bits << 1)) & 0x55555555;
+        return bits;
+    };
+    return spread(column) | (spread(row) << 1);
+}
+
+// Sort the records by Morton code if too many of them are out of order. Actors keep their ids and learn their new
+// records, and the id order follows the records, so the order actors act in and every query answer stay the same
+void StudentWorld::reorderRecords() {
+    int numberOfRecords = (int) m_records.size();
+    if (numberOfRecords < REORDER_MIN_RECORDS)
+        return;
+    AllocationScope scope(ALLOC_ENGINE);
+    m_mortonKeys.resize(numberOfRecords);
+    int outOfOrder = 0;
+    for (int i = 0; i < numberOfRecords; i++) {
+        m_mortonKeys[i] = ((unsigned long long) mortonCode(m_records[i].x, m_records[i].y) << 32) | (unsigned int) i;
+        if (i > 0 && (m_mortonKeys[i] >> 32) < (m_mortonKeys[i - 1] >> 32))
+            outOfOrder++;
+    }
+    if (outOfOrder * REORDER_DRIFT <= numberOfRecords)
+        return;
+    
+    sort(m_mortonKeys.begin(), m_mortonKeys.end());
+    m_recordBuffer.resize(numberOfRecords);
+    m_newIndex.resize(numberOfRecords);
+    for (int k = 0; k < numberOfRecords; k++) {
+        int i = (int) (m_mortonKeys[k] & 0xffffffff);
+        m_recordBuffer[k] = m_records[i];
+        m_newIndex[i] = k;
+        // Shared actors keep the record they had when they were forked, like when records are compacted
+        if (!(m_records[i].flags & FLAG_SHARED))
+            m_recordBuffer[k].actor->setRecord(k);
+    }
+    m_records.swap(m_recordBuffer);
+    for (size_t k = 0; k < m_idOrder.size(); k++)
+        m_idOrder[k] = m_newIndex[m_idOrder[k]];
+    m_staticCellsValid = false;
+    m_reorders++;
+}
+
+// Make room for a number of records, in the records and in every buffer as long as them, so that sorting and compacting
+// the records or collecting the candidates of a ring query never allocates partway through a level
+void StudentWorld::reserveRecords(size_t capacity) {
+    AllocationScope scope(ALLOC_ENGINE);
+    m_records.reserve(capacity);
+    m_idOrder.reserve(capacity);
+    m_mortonKeys.reserve(capacity);
+    m_newIndex.reserve(capacity);
+    m_recordBuffer.reserve(capacity);
+    m_ringCandidates.reserve(capacity);
+}
+
+// Give this world its own copy of a shared actor before it changes, the original stays on its page for the other forks
+Actor* StudentWorld::ownActor(int record) {
+    ActorRecord& shared = m_records[record];
+    if (!(shared.flags & FLAG_SHARED))
+        return shared.actor;
+    int page = shared.flags >> FLAG_PAGE_SHIFT;
+    Actor* copy = shared.actor->clone(this);
+    copy->setRecord(record);
+    shared.actor = copy;
+    shared.flags = copy->flags();
+    releasePage(page);
+    return copy;
+}
+
+// Let go of the actor of a record that leaves the world: delete it if the world owns it, otherwise stop using its page
+void StudentWorld::releaseActor(const ActorRecord& record) {
+    if (record.flags & FLAG_SHARED)
+        releasePage(record.flags >> FLAG_PAGE_SHIFT);
+    else
+        Actor::destroy(record.actor);
+}
+
+// Stop using a fork page once for one record, the page is dropped when no record points into it
+void StudentWorld::releasePage(int page) {
+    if (--m_pageUse[page] == 0)
+        m_pages[page].reset();
+}
+
+// Destructor, the last world to use the page deletes its actors
+ActorPage::~ActorPage() {
+    for (size_t i = 0; i < actors.size(); i++)
+        Actor::destroy(actors[i]);
+}
+
+// Fork the world between ticks. Every actor this world owns moves to a new page that the world and the fork share:
+// both treat shared actors as read only and copy one the first time they change it, so a fork costs little more than
+// a copy of the records and the player. Forks are headless and play on with the same random generator, so with the
+// same input they play the same game. A fork only reads what it shares with others, so forks of a world can run on
+// separate threads as long as the world itself is left alone meanwhile
+StudentWorld* StudentWorld::fork() {
+    if (m_player == nullptr || m_engine != ENGINE_OPTIMIZED || m_inTick)
+        return nullptr;
+    
+    // Move the actors this world owns onto a new page, reusing a free page slot if there is one
+    shared_ptr<ActorPage> page = make_shared<ActorPage>();
+    int slot = (int) (find(m_pages.begin(), m_pages.end(), nullptr) - m_pages.begin());
+    for (size_t i = 0; i < m_records.size(); i++) {
+        ActorRecord& record = m_records[i];
+        if (!(record.flags & FLAG_SHARED)) {
+            page->actors.push_back(record.actor);
+            record.flags |= FLAG_SHARED | ((unsigned int) slot << FLAG_PAGE_SHIFT);
+        }
+    }
+    if (!page->actors.empty()) {
+        if (slot == (int) m_pages.size()) {
+            m_pages.push_back(nullptr);
+            m_pageUse.push_back(0);
+        }
+        m_pages[slot] = page;
+        m_pageUse[slot] = (int) page->actors.size();
+    }
+    
+    StudentWorld* copy = new StudentWorld(assetPath(), true);
+    copy->increaseScore(getScore());
+    while (copy->getLives() < getLives())
+        copy->incLives();
+    while (copy->getLives() > getLives())
+        copy->decLives();
+    while (copy->getLevel() < getLevel())
+        copy->advanceToNextLevel();
+    
+    copy->m_player = static_cast<Socrates*>(m_player->clone(copy));
+    copy->reserveRecords(m_records.capacity());
+    copy->m_records = m_records;
+    copy->m_idOrder = m_idOrder;
+    for (size_t k = 0; k < m_idOrder.size(); k++)
+        copy->m_actors.push_back(m_records[m_idOrder[k]].actor);
+    copy->m_pages = m_pages;
+    copy->m_pageUse = m_pageUse;
+    copy->m_arena = m_arena;
+    copy->m_pits = m_pits;
+    copy->m_random = m_random;
+    copy->m_layoutRandom = m_layoutRandom;
+    copy->m_pregenerateLevels = m_pregenerateLevels;
+    copy->m_engine = m_engine;
+    copy->m_spatialReordering = m_spatialReordering;
+    copy->m_ticksPerMove = m_ticksPerMove;
+    copy->m_ticks = m_ticks;
+    copy->m_nextActorId = m_nextActorId;
+    copy->m_bacteria = m_bacteria;
+    copy->setAILevelOfDetail(m_aiLevelOfDetail);
+    copy->setWorldConfig(m_config);
+    copy->m_wakeVersions = m_wakeVersions;
+    copy->m_playerMoves = m_playerMoves;
+    return copy;
+}
+
+// Charge what follows to a phase of the tick, if the world is being profiled
+void StudentWorld::enterPhase(int phase) {
+    if (m_profiler != nullptr && phase != PHASE_NONE)
+        m_profiler->enter(phase);
+}
+
+// Return the phase of the tick an actor's turn is charged to, dirt and food do nothing and stay in the current one
+int StudentWorld::actorPhase(int objectType) const {
+    switch (objectType) {
+        case ID_PIT:
+            return PHASE_PITS;
+        case ID_SPRAY:
+        case ID_FLAME:
+            return PHASE_PROJECTILES;
+        case ID_HEALTH_GOODIE:
+        case ID_FLAME_GOODIE:
+        case ID_LIFE_GOODIE:
+        case ID_FUNGI:
+            return PHASE_ITEMS;
+        case ID_REGULAR_SALMONELLA:
+        case ID_AGGRESSIVE_SALMONELLA:
+        case ID_ECOLI:
+            return PHASE_BACTERIA;
+        default:
+            return PHASE_NONE;
+    }
+}
+
+// Check whether an object type is one of the bacteria
+bool StudentWorld::isBacteria(int objectType) const {
+    return hasType(MASK_BACTERIA, objectType);
 }
 
 // Decrease recorded number of pits by one
@@ -225,14 +1536,362 @@ void StudentWorld::decreasePits() {
     m_pits--;
 }
 
-// Check to see if two given actors overlap within a certain radius
-bool StudentWorld::isOverlap(Actor* actor1, Actor* actor2, double radius) const {
+// Return the number of actors in the level, not counting the player
+int StudentWorld::numberOfActors() const {
+    return (int) m_records.size();
+}
+
+// Return the number of actors of a given type in the level
+int StudentWorld::numberOfActors(int objectType) const {
+    int count = 0;
+    for (size_t i = 0; i < m_records.size(); i++) {
+        if ((int) (m_records[i].flags & FLAG_TYPE_MASK) == objectType)
+            count++;
+    }
+    return count;
+}
+
+// Set up the AI level of detail
+void StudentWorld::setAILevelOfDetail(const AILevelOfDetail& settings) {
+    m_aiLevelOfDetail = settings;
+    
+    // Scaled steps move bacteria further per tick, so the broadphase has to look further ahead
+    m_broadphaseMargin = BROADPHASE_MARGIN;
+    if (settings.enabled) {
+        for (int i = 0; i < AI_LOD_BANDS; i++)
+            m_broadphaseMargin = max(m_broadphaseMargin, 3.0 * settings.bandInterval[i] + 1);
+    }
+}
+
+// Return the AI level of detail settings
+const AILevelOfDetail& StudentWorld::aiLevelOfDetail() const {
+    return m_aiLevelOfDetail;
+}
+
+// Decide how a bacterium runs its final action this tick: 1 for a regular step, a larger number for a
+// scaled step that stands for that many regular ones, or 0 to skip it
+// Bacteria of a band take turns by id, and ones that lose out to the budget go first next tick
+int StudentWorld::aiStepScale(Actor* bacterium, bool& pending) {
+    if (!m_aiLevelOfDetail.enabled)
+        return 1;
+    
+    double dx = bacterium->getX() - m_player->getX();
+    double dy = bacterium->getY() - m_player->getY();
+    double distanceToPlayer = sqrt(dx*dx + dy*dy);
+    int interval = 1;
+    for (int i = 0; i < AI_LOD_BANDS; i++) {
+        if (distanceToPlayer >= m_aiLevelOfDetail.bandDistance[i])
+            interval = m_aiLevelOfDetail.bandInterval[i];
+    }
+    if (interval <= 1)
+        return 1;
+    
+    if (!pending && (m_ticks + bacterium->id()) % interval != 0)
+        return 0;
+    if (m_aiLevelOfDetail.budget > 0 && m_aiBudgetUsed >= m_aiLevelOfDetail.budget) {
+        pending = true;
+        return 0;
+    }
+    m_aiBudgetUsed++;
+    pending = false;
+    return interval;
+}
+
+// Return the number of pits that are still releasing bacteria
+int StudentWorld::pits() const {
+    return m_pits;
+}
+
+// Return the number of ticks played in the current level
+int StudentWorld::ticks() const {
+    return m_ticks;
+}
+
+// Return a random integer from min to max inclusive, drawn from the world's own generator
+int StudentWorld::randInt(int min, int max) {
+    return rollInt(m_random, min, max);
+}
+
+// Restart the world's random generator from a given seed
+void StudentWorld::seedRandom(unsigned int seed) {
+    m_random.seed(seed);
+    seed_seq layoutSeed = { seed, 1u };
+    m_layoutRandom.seed(layoutSeed);
+    discardLayouts();
+}
+
+// Lay out each next level on a worker thread while the current one is played, so that init only has to create the actors
+// Levels are then laid out from a generator of their own, apart from the one the game plays with, so that the layout
+// can be drawn before the level it follows is over. A seed still reproduces a whole game, but not the same game as
+// without pregeneration
+void StudentWorld::setLevelPregeneration(bool enabled) {
+    discardLayouts();
+    m_pregenerateLevels = enabled;
+}
+
+// Return whether levels are laid out in the background
+bool StudentWorld::levelPregeneration() const {
+    return m_pregenerateLevels;
+}
+
+// Replace the size of the dish and the makeup of each level, takes effect from the next level
+void StudentWorld::setWorldConfig(const WorldConfig& config) {
+    m_config = config;
+    discardLayouts();
+    m_staticCellsValid = false;
+    resetWakeCells();
+    if (m_queryProfiler != nullptr)
+        m_queryProfiler->setDish(dishCenterX(), dishCenterY(), dishRadius());
+}
+
+// Return the size of the dish and the makeup of each level
+const WorldConfig& StudentWorld::worldConfig() const {
+    return m_config;
+}
+
+// Return the horizontal center of the dish
+double StudentWorld::dishCenterX() const {
+    return m_config.dishRadius;
+}
+
+// Return the vertical center of the dish
+double StudentWorld::dishCenterY() const {
+    return m_config.dishRadius;
+}
+
+// Return the radius of the dish
+double StudentWorld::dishRadius() const {
+    return m_config.dishRadius;
+}
+
+// Select the engine that runs each tick
+void StudentWorld::setEngine(int engine) {
+    m_engine = engine;
+}
+
+// Return the engine that runs each tick
+int StudentWorld::engine() const {
+    return m_engine;
+}
+
+// Collect the state of the player and every actor, ordered by id
+void StudentWorld::getState(vector<ActorState>& states) const {
+    states.clear();
+    if (m_player == nullptr)
+        return;
+    size_t room = 1;
+    for (size_t i = 0; i < m_records.size(); i++)
+        room += m_records[i].actor->idCount();
+    states.resize(room);
+    m_player->getState(states[0]);
+    size_t count = 1;
+    for (size_t i = 0; i < m_records.size(); i++)
+        count += m_records[i].actor->getStates(&states[count]);
+    states.resize(count);
+    sort(states.begin(), states.end(), [](const ActorState& a, const ActorState& b) { return a.id < b.id; });
+}
+
+// Hash the canonical state of the world: every actor's state plus the score, lives, level, pits and tick
+unsigned long long StudentWorld::stateHash() const {
+    // 64 bit FNV-1a over the raw bytes of each field
+    unsigned long long hash = 14695981039346656037ULL;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = (const unsigned char*) data;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
     
-    double x1 = actor1->getX();
-    double y1 = actor1->getY();
-    double x2 = actor2->getX();
-    double y2 = actor2->getY();
+    vector<ActorState> states;
+    getState(states);
+    for (size_t i = 0; i < states.size(); i++) {
+        const ActorState& state = states[i];
+        int active = state.active;
+        mix(&state.id, sizeof(state.id));
+        mix(&state.objectType, sizeof(state.objectType));
+        mix(&state.x, sizeof(state.x));
+        mix(&state.y, sizeof(state.y));
+        mix(&state.direction, sizeof(state.direction));
+        mix(&active, sizeof(active));
+        mix(&state.hitPoints, sizeof(state.hitPoints));
+        mix(state.counters, sizeof(state.counters));
+    }
     
+    unsigned int worldFields[] = { getScore(), getLives(), getLevel(), (unsigned int) m_pits, (unsigned int) m_ticks };
+    mix(worldFields, sizeof(worldFields));
+    return hash;
+}
+
+// Return the compact records of every actor in the level, in Morton order once the optimized engine has sorted them
+const vector<ActorRecord>& StudentWorld::records() const {
+    return m_records;
+}
+
+// Return the indices of the records in list order
+const vector<int>& StudentWorld::idOrder() const {
+    return m_idOrder;
+}
+
+// Turn Morton ordering of the records on or off
+void StudentWorld::setSpatialReordering(bool enabled) {
+    m_spatialReordering = enabled;
+}
+
+// Return whether the records are kept in Morton order
+bool StudentWorld::spatialReordering() const {
+    return m_spatialReordering;
+}
+
+// Return the number of times the records were sorted into Morton order
+int StudentWorld::reorders() const {
+    return m_reorders;
+}
+
+// Make each move fast-forward a number of ticks
+void StudentWorld::setTicksPerMove(int ticks) {
+    m_ticksPerMove = max(ticks, 1);
+}
+
+// Return the number of ticks each move plays
+int StudentWorld::ticksPerMove() const {
+    return m_ticksPerMove;
+}
+
+// Return the number of ticks fast-forward jumped over instead of playing
+int StudentWorld::jumpedTicks() const {
+    return m_jumpedTicks;
+}
+
+// Measure the phases of every tick with a profiler, or stop measuring with nullptr
+void StudentWorld::setProfiler(PhaseProfiler* profiler) {
+    m_profiler = profiler;
+}
+
+// Record the metrics of every tick with a telemetry writer, or stop recording with nullptr
+void StudentWorld::setTelemetry(TelemetryWriter* telemetry) {
+    m_telemetry = telemetry;
+}
+
+// Record the rewind history of every level from the next one on, or stop recording with nullptr
+void StudentWorld::setRewind(RewindBuffer* rewind) {
+    m_rewind = rewind;
+}
+
+// Set the render buffer frames are published to, nullptr for none
+void StudentWorld::setRenderBuffer(RenderBuffer* render) {
+    m_render = render;
+}
+
+// Charge the spatial queries to a profiler over the dish as it is now, nullptr for none
+void StudentWorld::setQueryProfiler(QueryProfiler* profiler) {
+    m_queryProfiler = profiler;
+    if (m_queryProfiler != nullptr)
+        m_queryProfiler->setDish(dishCenterX(), dishCenterY(), dishRadius());
+}
+
+// Write what the display needs of the tick that just ended into a frame, which keeps its room from one tick to the next
+void StudentWorld::renderFrame(RenderFrame& frame) const {
+    AllocationScope scope(ALLOC_HUD);
+    frame.tick = m_ticks;
+    frame.level = getLevel();
+    frame.score = getScore();
+    frame.lives = getLives();
+    frame.sprites.clear();
+    if (m_player == nullptr)
+        return;
+    if (m_player->isActive()) {
+        frame.sprites.resize(1);
+        m_player->getSprites(&frame.sprites[0]);
+    }
+    for (size_t k = 0; k < m_idOrder.size(); k++) {
+        const ActorRecord& record = m_records[m_idOrder[k]];
+        if (!(record.flags & FLAG_ACTIVE))
+            continue;
+        size_t count = frame.sprites.size();
+        frame.sprites.resize(count + record.actor->idCount());
+        frame.sprites.resize(count + record.actor->getSprites(&frame.sprites[count]));
+    }
+}
+
+// Hand the metrics of the tick that just ended to the telemetry writer, which drops them rather than wait if it is behind
+void StudentWorld::recordTelemetry(int status, float tickMicroseconds) {
+    TelemetryRecord record;
+    record.tick = m_ticks;
+    record.level = getLevel();
+    record.status = status;
+    record.score = getScore();
+    record.lives = getLives();
+    record.hitPoints = m_player->hitPoints();
+    record.sprays = m_player->sprays();
+    record.flames = m_player->ftCharges();
+    record.tickMicroseconds = tickMicroseconds;
+    for (int i = 0; i < TELEMETRY_OBJECT_TYPES; i++)
+        record.actors[i] = 0;
+    record.actors[ID_SOCRATES] = m_player->isActive() ? 1 : 0;
+    ActorState flames[FLAME_BURST_RAYS];
+    for (size_t i = 0; i < m_records.size(); i++) {
+        if (!(m_records[i].flags & FLAG_ACTIVE))
+            continue;
+        // A flame burst counts as the flames still in play it stands for
+        int type = m_records[i].flags & FLAG_TYPE_MASK;
+        if (type == ID_FLAME && m_records[i].actor->idCount() > 1)
+            record.actors[type] += m_records[i].actor->getStates(flames);
+        else
+            record.actors[type]++;
+    }
+    record.projectiles = record.actors[ID_SPRAY] + record.actors[ID_FLAME];
+    m_telemetry->record(record);
+}
+
+// Return whether the world is running without a display
+bool StudentWorld::isHeadless() const {
+    return m_headless;
+}
+
+// Replace the keyboard with another source of key presses, the world does not take ownership
+void StudentWorld::setInputSource(InputSource* input) {
+    m_input = input;
+}
+
+// Get the next key press from the input source, or the keyboard if there is none, and remember it for the rewind history
+// Headless worlds without an input source never receive any input
+bool StudentWorld::getKey(int& value) {
+    if (m_keyPending) {
+        m_keyPending = false;
+        value = m_pendingKey;
+        m_tickKeyPressed = m_pendingKeyPressed;
+    }
+    else if (m_input != nullptr)
+        m_tickKeyPressed = m_input->getKey(*this, value);
+    else if (m_headless)
+        m_tickKeyPressed = false;
+    else
+        m_tickKeyPressed = GameWorld::getKey(value);
+    if (m_tickKeyPressed)
+        m_tickKey = value;
+    return m_tickKeyPressed;
+}
+
+// Play a sound, unless the world is headless
+void StudentWorld::playSound(int soundID) {
+    if (!m_headless)
+        GameWorld::playSound(soundID);
+}
+
+// Update the text at the top of the screen, unless the world is headless
+void StudentWorld::setGameStatText(string text) {
+    if (!m_headless)
+        GameWorld::setGameStatText(text);
+}
+
+// Check to see if two given actors overlap within a certain radius
+bool StudentWorld::isOverlap(Actor* actor1, Actor* actor2, double radius) const {
+    return pointsOverlap(actor1->getX(), actor1->getY(), actor2->getX(), actor2->getY(), radius);
+}
+
+// Check to see if two points are within a certain radius of each other
+bool StudentWorld::pointsOverlap(double x1, double y1, double x2, double y2, double radius) {
     double dx = x2 - x1;
     double dy = y2 - y1;
     
@@ -243,14 +1902,11 @@ bool StudentWorld::isOverlap(Actor* actor1, Actor* actor2, double radius) const
 
 // Create a list of all actors in the game that overlap with a given actor within a certain radius
 void StudentWorld::getOverlap(Actor* actor, list<Actor*>& actorsThatOverlap, double radius) {
-    for (list<Actor*>::iterator p = m_actors.begin(); p != m_actors.end(); p++) {
-        if (isOverlap(actor, *p, radius) && *p != actor)
-            actorsThatOverlap.push_back(*p);
-    }
-    if (actor->objectType() != ID_SOCRATES) {
-        if (isOverlap(actor, m_player, radius))
-            actorsThatOverlap.push_back(m_player);
-    }
+    AllocationScope scope(ALLOC_QUERIES);
+    forEachOverlap(actor, MASK_ALL_TYPES, radius, [&actorsThatOverlap](Actor* other) {
+        actorsThatOverlap.push_back(other);
+        return true;
+    });
 }
 
 // Return the player
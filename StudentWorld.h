@@ -2,51 +2,403 @@
 #define STUDENTWORLD_H_
 
 #include "GameWorld.h"
+#include "WorldConfig.h"
+#include "LevelArena.h"
 #include <string>
 #include <list>
+#include <vector>
+#include <random>
+#include <memory>
+#include <future>
 using namespace std;
 
-// Constants for object type
-
-const int ID_SOCRATES               = 0;
-const int ID_REGULAR_SALMONELLA     = 1;
-const int ID_AGGRESSIVE_SALMONELLA  = 2;
-const int ID_ECOLI                  = 3;
-const int ID_PIT                    = 4;
-const int ID_FLAME                  = 5;
-const int ID_SPRAY                  = 6;
-const int ID_DIRT                   = 7;
-const int ID_FOOD                   = 8;
-const int ID_HEALTH_GOODIE          = 9;
-const int ID_FLAME_GOODIE           = 10;
-const int ID_LIFE_GOODIE            = 11;
-const int ID_FUNGI                  = 12;
+// Object types
+
+enum ObjectType {
+    ID_SOCRATES                 = 0,
+    ID_REGULAR_SALMONELLA       = 1,
+    ID_AGGRESSIVE_SALMONELLA    = 2,
+    ID_ECOLI                    = 3,
+    ID_PIT                      = 4,
+    ID_FLAME                    = 5,
+    ID_SPRAY                    = 6,
+    ID_DIRT                     = 7,
+    ID_FOOD                     = 8,
+    ID_HEALTH_GOODIE            = 9,
+    ID_FLAME_GOODIE             = 10,
+    ID_LIFE_GOODIE              = 11,
+    ID_FUNGI                    = 12,
+    NUMBER_OF_OBJECT_TYPES      = 13
+};
+
+// Bitmasks of object types, for queries that only look for some of them
+
+constexpr unsigned int typeMask(int objectType) {
+    return 1u << objectType;
+}
+
+template <typename... ObjectTypes>
+constexpr unsigned int typeMask(int objectType, ObjectTypes... more) {
+    return typeMask(objectType) | typeMask(more...);
+}
+
+constexpr unsigned int MASK_ALL_TYPES       = (1u << NUMBER_OF_OBJECT_TYPES) - 1;
+constexpr unsigned int MASK_BACTERIA        = typeMask(ID_REGULAR_SALMONELLA, ID_AGGRESSIVE_SALMONELLA, ID_ECOLI);
+constexpr unsigned int MASK_PROJECTILES     = typeMask(ID_SPRAY, ID_FLAME);
+constexpr unsigned int MASK_ITEMS           = typeMask(ID_HEALTH_GOODIE, ID_FLAME_GOODIE, ID_LIFE_GOODIE, ID_FUNGI);
+constexpr unsigned int MASK_STATIC          = typeMask(ID_PIT, ID_FOOD, ID_DIRT);          // Never move
+constexpr unsigned int MASK_INERT           = typeMask(ID_DIRT, ID_FOOD);                  // Do nothing on their own
+constexpr unsigned int MASK_DAMAGEABLE      = MASK_BACTERIA | MASK_ITEMS | typeMask(ID_DIRT); // Hit by sprays and flames
+constexpr unsigned int MASK_BLOCKING        = typeMask(ID_DIRT);                           // Stand in the way of bacteria
+constexpr unsigned int MASK_EDIBLE          = typeMask(ID_FOOD);                           // Eaten by bacteria
+
+// Whether an object type is in a mask
+constexpr bool hasType(unsigned int mask, int objectType) {
+    return (typeMask(objectType) & mask) != 0;
+}
+
+// Layout of the packed flags word of actors and actor records
+
+const unsigned int FLAG_TYPE_MASK   = 0xff;
+const unsigned int FLAG_ACTIVE      = 0x100;
+const unsigned int FLAG_SHARED      = 0x200;    // Records only: the actor lives on a fork page, see StudentWorld::fork
+const unsigned int FLAG_ARENA       = 0x400;    // The actor lives in a level arena, see StudentWorld::init
+const int FLAG_PAGE_SHIFT           = 12;       // Records only: the bits from here up hold the fork page of a shared actor
+
+// Constants for the engine that runs each tick
+
+const int ENGINE_REFERENCE          = 0;    // The original list-based logic, kept to validate optimizations against
+const int ENGINE_OPTIMIZED          = 1;
 
 class Socrates;
 class Actor;
+struct ActorState;
+class PhaseProfiler;
+class TelemetryWriter;
+class RewindBuffer;
+class RenderBuffer;
+struct RenderFrame;
+class QueryProfiler;
+
+class StudentWorld;
+
+// A source of key presses for the player, used in place of the keyboard
+class InputSource {
+  public:
+    virtual ~InputSource() {}
+    virtual bool getKey(StudentWorld& world, int& value) = 0;
+};
+
+// Compact simulation record kept for every actor of the level, in the same order as the list of actors
+// Overlap queries scan these instead of chasing list nodes into each actor, two records fit in a cache line
+struct ActorRecord {
+    float x;
+    float y;
+    unsigned int flags;     // Object type and active flag of the actor, and its page if it is shared with forks
+    int id;
+    Actor* actor;
+};
+
+// A point of a ring of projectiles fired from one spot and the types of actor it can hit, see StudentWorld::ringContacts
+struct RingPoint {
+    double x;
+    double y;
+    unsigned int types;
+};
+
+// The broadphase pairs everything that can touch within SPRITE_WIDTH this tick
+// Bacteria move at most 3 units per tick before their own checks, the margin covers that
+const double BROADPHASE_MARGIN = 4;
+
+// Opt-in AI level of detail: bacteria far from the player think less often and take proportionally bigger steps
+const int AI_LOD_BANDS = 3;
+
+struct AILevelOfDetail {
+    bool enabled;
+    double bandDistance[AI_LOD_BANDS];  // Bacteria at least this far from the player...
+    int bandInterval[AI_LOD_BANDS];     // ...run their final action once every this many ticks
+    int budget;                         // Most reduced detail final actions per tick, 0 for no limit
+};
+
+// Actors that were live when a world was forked, shared read only by the world and its forks
+// The page deletes its actors once no world uses it anymore
+struct ActorPage {
+    vector<Actor*> actors;
+    ~ActorPage();
+};
+
+// Where a level starts out with its pits, food and dirt, and the state of the generator they were drawn from
+struct LayoutObject {
+    int objectType;
+    double x;
+    double y;
+};
+
+struct LevelLayout {
+    int level;
+    vector<LayoutObject> objects;       // Pits, then food, then dirt, in the order they were placed
+    mt19937 random;                     // The generator after the last position was drawn
+};
+
+// Room reserved up front for the actors spawned during a single tick
+const int SPAWN_BUFFER_RESERVE = 256;
+
+// Float positions are exact to well within this distance anywhere in the dish, records within it are rechecked exactly
+const double RECORD_POSITION_SLACK = 0.01;
+
+// Pits, food and dirt never move, so the optimized engine keeps them in a grid of cells two sprites wide for point queries
+const double STATIC_GRID_CELL = 16;
+
+// The optimized engine keeps the actor records sorted by the Morton code of their position, so that actors close in the
+// dish are close in memory. Every REORDER_CHECK_INTERVAL ticks it counts the records that are out of that order, and sorts
+// them again once more than one in REORDER_DRIFT is. Small levels fit in cache as they are and are left alone
+const int REORDER_CHECK_INTERVAL = 32;
+const int REORDER_DRIFT = 8;
+const int REORDER_MIN_RECORDS = 64;
 
 class StudentWorld : public GameWorld
 {
 public:
-    StudentWorld(std::string assetPath);
+    StudentWorld(std::string assetPath, bool headless = false);
     ~StudentWorld();
     virtual int init();
     virtual int move();
     virtual void cleanUp();
+
+    // Fast-forward: ticks played back to back, with the game text only updated after the last one. Stretches in which
+    // nothing happens but item lifetimes running down, sprays recharging and random rolls coming up empty are jumped over
+    // in one go. The game played is exactly the one move plays tick by tick
+    int fastForward(int ticks, int& ticksPlayed);
+    void setTicksPerMove(int ticks);    // Each move fast-forwards this many ticks, so the display shows every this many
+    int ticksPerMove() const;
+    int jumpedTicks() const;
+    void initEmptyDish();
     void addActor(Actor* newActor);
     Socrates* player() const;
     bool isOverlap(Actor* actor1, Actor* actor2, double radius) const;
     void getOverlap(Actor* actor, list<Actor*>& actorsThatOverlap, double radius);
+    
+    // Visit the actors of the given types that overlap an actor, in getOverlap's order, until the visitor returns false,
+    // and return whether it stopped early. Nothing is allocated. Visited actors may be shared with forks, so visitors only
+    // read them: the actors firstContact and lastContact return are the ones that may be changed
+    template <typename Visitor>
+    bool forEachOverlap(Actor* actor, unsigned int types, double radius, Visitor visit);
+    bool anyOverlap(Actor* actor, unsigned int types, double radius);
+    
+    // Overlaps from the per-tick broadphase: projectiles with damageable actors, bacteria with food,
+    // and bacteria or items with the player. The first or last actor of one of the given types that
+    // getOverlap would list, without building the list
+    Actor* firstContact(Actor* actor, unsigned int types, double radius);
+    Actor* lastContact(Actor* actor, unsigned int types, double radius);
+    bool overlapsPlayer(Actor* actor, double radius);
+    
+    // The actor firstContact would find for each point of a ring of projectiles fired from a center, nullptr for none,
+    // from a single query over the ring the points lie on. Never the player
+    void ringContacts(double centerX, double centerY, const RingPoint* points, int count, double radius, Actor** contacts);
+    
+    // Allocation free queries for the bacteria's movement checks and for placing objects
+    bool isDirtAt(double x, double y, double radius) const;
+    bool isAnyAt(double x, double y, unsigned int types, double radius) const;
+    Actor* nearestActor(Actor* actor, int objectType, double maxDistance) const;
+    
+    // Pits, food and dirt never move, so projectiles work out once where on their path they could first hit them
+    int firstStaticStep(double x, double y, int direction, double stepLength, int steps, unsigned int types, double radius) const;
+    int staticVersion() const;
+    
+    // A number that changes whenever dirt is added or removed within a grid cell of a point, plus the number of times the
+    // player moved if asked for, so that bacteria blocked there can sleep until it changes. -1 if bacteria may not sleep
+    int sleepVersion(double x, double y, bool watchPlayer) const;
     void decreasePits();
+    void updateRecord(Actor* actor);
+    int numberOfActors() const;
+    int numberOfActors(int objectType) const;
+    const vector<ActorRecord>& records() const;
+    const vector<int>& idOrder() const;
+    int pits() const;
+    int ticks() const;
+    
+    // Size of the dish and makeup of each level, set between levels
+    void setWorldConfig(const WorldConfig& config);
+    const WorldConfig& worldConfig() const;
+    double dishCenterX() const;
+    double dishCenterY() const;
+    double dishRadius() const;
+    
+    // Every random roll of the level comes from the world, so that a seed reproduces a whole game
+    int randInt(int min, int max);
+    void seedRandom(unsigned int seed);
+    
+    // Lays out the levels that can come next on a worker thread while a level is played, off unless enabled
+    void setLevelPregeneration(bool enabled);
+    bool levelPregeneration() const;
+    static LevelLayout generateLayout(const WorldConfig& config, int level, const mt19937& random);
+    
+    // Selects the engine that runs each tick, both must play exactly the same game
+    void setEngine(int engine);
+    int engine() const;
+    
+    // Morton ordering of the actor records, on unless disabled, and the number of times the records were sorted
+    void setSpatialReordering(bool enabled);
+    bool spatialReordering() const;
+    int reorders() const;
+    
+    // AI level of detail for far away bacteria, off unless enabled
+    void setAILevelOfDetail(const AILevelOfDetail& settings);
+    const AILevelOfDetail& aiLevelOfDetail() const;
+    int aiStepScale(Actor* bacterium, bool& pending);
+    
+    // Canonical state of the world, with actors ordered by id
+    void getState(vector<ActorState>& states) const;
+    unsigned long long stateHash() const;
+    
+    // Copy-on-write fork of the world between ticks, for look-ahead search. Returns nullptr unless the optimized engine runs
+    StudentWorld* fork();
+    
+    // Optional per phase instrumentation of move, the world does not take ownership
+    void setProfiler(PhaseProfiler* profiler);
+    
+    // Optional per tick metrics, written to a file off the tick thread, the world does not take ownership
+    void setTelemetry(TelemetryWriter* telemetry);
+
+    // Optional rewind history of the level being played, the world does not take ownership
+    void setRewind(RewindBuffer* rewind);
+    
+    // Optional render frames for a display on another thread, published when a level starts and whenever the game text is
+    // updated, the world does not take ownership. renderFrame writes one into any frame
+    void setRenderBuffer(RenderBuffer* render);
+    void renderFrame(RenderFrame& frame) const;
+
+    // Optional statistics of the spatial queries by call site, with heatmaps of where they are made, the world does not
+    // take ownership
+    void setQueryProfiler(QueryProfiler* profiler);
+    
+    // Framework calls are routed through the world so that headless runs never touch the display
+    bool isHeadless() const;
+    void setInputSource(InputSource* input);
+    bool getKey(int& value);
+    void playSound(int soundID);
+    void setGameStatText(string text);
 
 private:
     // Data Members
     Socrates* m_player;
     list<Actor*> m_actors;
+    vector<ActorRecord> m_records;
+    vector<int> m_idOrder;              // Record indices in id order, the order actors act in and are listed in
+    vector<Actor*> m_spawns;
+    bool m_inTick;
+    
+    // Broadphase, rebuilt once per tick by the optimized engine
+    bool m_contactsValid;
+    vector<int> m_cellOf;               // Grid cell of record i
+    vector<int> m_cellStart;            // Records grouped by grid cell, in counting sort layout
+    vector<int> m_cellFill;
+    vector<int> m_cellRecords;
+    vector<int> m_contactStart;         // Contacts of record i are m_contactTargets[m_contactStart[i] .. m_contactStart[i+1])
+    vector<int> m_contactTargets;       // Record indices, so that targets copied from a fork page during the tick are found
+    vector<char> m_nearPlayer;          // Whether record i may touch the player this tick
+    vector<int> m_ringCandidates;       // Record indices, kept for the next ring query
+    double m_broadphaseMargin;
+    
+    // Record indices of pits, food and dirt by grid cell, built when first queried after the records were compacted
+    mutable vector<vector<int>> m_staticCells;
+    mutable bool m_staticCellsValid;
+    mutable int m_staticColumns;
+    int m_staticVersion;
+    
+    // Versions of the regions sleeping bacteria wait on, by cell of a grid as fine as the static one
+    vector<int> m_wakeVersions;
+    int m_wakeColumns;
+    int m_playerMoves;
+    
+    // Morton ordering of the records, the buffers keep their room from one sort to the next
+    bool m_spatialReordering;
+    int m_reorders;
+    vector<unsigned long long> m_mortonKeys;    // Morton code in the high half, record index in the low half
+    vector<int> m_newIndex;                     // Where record i went in the last sort or compaction, -1 if it was dropped
+    vector<ActorRecord> m_recordBuffer;
+    
+    // Fork pages this world still has shared actors on, and how many of its records point into each
+    vector<shared_ptr<ActorPage>> m_pages;
+    vector<int> m_pageUse;
+    
+    // Memory of the player, pits, food and dirt of the level, shared with forks that may still hold actors in it
+    shared_ptr<LevelArena> m_arena;
+    size_t m_arenaHighWater;            // Bytes the last level took from its arena
+    
+    WorldConfig m_config;
+    AILevelOfDetail m_aiLevelOfDetail;
+    int m_aiBudgetUsed;
     int m_pits;
+    bool m_headless;
+    InputSource* m_input;
+    PhaseProfiler* m_profiler;
+    TelemetryWriter* m_telemetry;
+    RewindBuffer* m_rewind;
+    RenderBuffer* m_render;
+    QueryProfiler* m_queryProfiler;
+    bool m_tickKeyPressed;              // The key the player read this tick, for the rewind history
+    int m_tickKey;
+    mt19937 m_random;
+    mt19937 m_layoutRandom;             // Lays out the levels instead of m_random while levels are pregenerated
+    bool m_pregenerateLevels;
+    future<vector<LevelLayout>> m_preparedLayouts;
+    int m_engine;
+    int m_ticks;
+    int m_nextActorId;
+    int m_bacteria;
+    
+    // Fast-forward, and the key a jump read for the tick after it
+    int m_ticksPerMove;
+    int m_jumpedTicks;
+    bool m_keyPending;
+    bool m_pendingKeyPressed;
+    int m_pendingKey;
     
     // Helper Functions
-    void getRandomPoint(double &x, double &y);
+    static void getRandomPoint(const WorldConfig& config, mt19937& random, double &x, double &y);
+    int playTick(bool updateText);
+    void updateGameText();
+    void publishFrame();
+    int jumpQuietTicks(int maxTicks);
+    LevelLayout takeLayout(int level);
+    void prepareLayouts();
+    void discardLayouts();
+    template <typename T> T* newLevelActor(double x, double y);
+    void insertActor(Actor* newActor);
+    typedef bool (*OverlapVisitor)(Actor* other, void* context);
+    bool visitOverlaps(Actor* actor, unsigned int types, double radius, OverlapVisitor visit, void* context);
+    int updateActorsReference();
+    int updateActorsOptimized();
+    bool isBacteria(int objectType) const;
+    Actor* findContact(Actor* actor, unsigned int types, double radius, bool last, int site);
+    unsigned int broadphaseTargets(int objectType) const;
+    static bool pointsOverlap(double x1, double y1, double x2, double y2, double radius);
+    bool isStatic(int objectType) const;
+    int staticContact(Actor* actor, unsigned int types, double radius, bool last, int& examined) const;
+    bool findAnyAt(double x, double y, unsigned int types, double radius, int site) const;
+    int staticCell(double x, double y, int& column, int& row) const;
+    void buildStaticCells() const;
+    void resetWakeCells();
+    void touchWakeCells(double x, double y);
+    Actor* ownActor(int record);
+    void releaseActor(const ActorRecord& record);
+    void releasePage(int page);
+    void removeInactiveActors();
+    unsigned int mortonCode(float x, float y) const;
+    void reorderRecords();
+    void reserveRecords(size_t capacity);
+    void enterPhase(int phase);
+    void recordTelemetry(int status, float tickMicroseconds);
+    int actorPhase(int objectType) const;
+    void commitSpawns();
+    void buildContacts();
 };
 
+// The query runs behind a plain function pointer, so that it is compiled once for every visitor
+template <typename Visitor>
+bool StudentWorld::forEachOverlap(Actor* actor, unsigned int types, double radius, Visitor visit) {
+    return visitOverlaps(actor, types, radius, [](Actor* other, void* context) { return (*static_cast<Visitor*>(context))(other); }, &visit);
+}
+
 #endif // STUDENTWORLD_H_
@@ -0,0 +1,254 @@
+#include "Telemetry.h"
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+using namespace std;
+
+/*---------------------*/
+/*---------Ring--------*/
+/*---------------------*/
+
+// Constructor, rounds the capacity up to a power of two so that slots are found with a mask
+TelemetryRing::TelemetryRing(size_t capacity)
+    : m_head(0), m_tail(0)
+{
+    size_t size = 1;
+    while (size < capacity)
+        size *= 2;
+    m_slots.resize(size);
+    m_mask = size - 1;
+}
+
+// Copy a record into the next free slot, unless the consumer has not read the oldest one yet
+bool TelemetryRing::push(const TelemetryRecord& record) {
+    size_t head = m_head.load(memory_order_relaxed);
+    if (head - m_tail.load(memory_order_acquire) == m_slots.size())
+        return false;
+    m_slots[head & m_mask] = record;
+    m_head.store(head + 1, memory_order_release);
+    return true;
+}
+
+// Copy the oldest record out of the ring and free its slot
+bool TelemetryRing::pop(TelemetryRecord& record) {
+    size_t tail = m_tail.load(memory_order_relaxed);
+    if (tail == m_head.load(memory_order_acquire))
+        return false;
+    record = m_slots[tail & m_mask];
+    m_tail.store(tail + 1, memory_order_release);
+    return true;
+}
+
+// Return the number of records the ring holds
+size_t TelemetryRing::capacity() const {
+    return m_slots.size();
+}
+
+/*---------------------*/
+/*-------Columns-------*/
+/*---------------------*/
+
+// Return the columns of the file, in the order they are written
+const vector<TelemetryColumn>& telemetryColumns() {
+    static const vector<TelemetryColumn> columns = [] {
+        vector<TelemetryColumn> list = {
+            { "tick", TELEMETRY_INT, offsetof(TelemetryRecord, tick) },
+            { "level", TELEMETRY_INT, offsetof(TelemetryRecord, level) },
+            { "status", TELEMETRY_INT, offsetof(TelemetryRecord, status) },
+            { "score", TELEMETRY_UNSIGNED, offsetof(TelemetryRecord, score) },
+            { "lives", TELEMETRY_INT, offsetof(TelemetryRecord, lives) },
+            { "hit_points", TELEMETRY_INT, offsetof(TelemetryRecord, hitPoints) },
+            { "sprays", TELEMETRY_INT, offsetof(TelemetryRecord, sprays) },
+            { "flames", TELEMETRY_INT, offsetof(TelemetryRecord, flames) },
+            { "projectiles", TELEMETRY_INT, offsetof(TelemetryRecord, projectiles) },
+            { "tick_us", TELEMETRY_FLOAT, offsetof(TelemetryRecord, tickMicroseconds) },
+        };
+        const char* const types[TELEMETRY_OBJECT_TYPES] = { "socrates", "regular_salmonella", "aggressive_salmonella", "ecoli", "pit",
+            "flame", "spray", "dirt", "food", "health_goodie", "flame_goodie", "life_goodie", "fungus" };
+        for (int i = 0; i < TELEMETRY_OBJECT_TYPES; i++)
+            list.push_back({ string("actors_") + types[i], TELEMETRY_INT, offsetof(TelemetryRecord, actors) + i * sizeof(int) });
+        return list;
+    }();
+    return columns;
+}
+
+/*---------------------*/
+/*--------Writer-------*/
+/*---------------------*/
+
+// Constructor
+TelemetryWriter::TelemetryWriter(size_t capacity)
+    : m_ring(capacity), m_running(false), m_written(0), m_dropped(0)
+{
+    m_block.reserve(TELEMETRY_BLOCK_RECORDS);
+}
+
+// Destructor, finishes the file
+TelemetryWriter::~TelemetryWriter() {
+    close();
+}
+
+// Start a new file and the thread that writes it
+bool TelemetryWriter::open(const string& path) {
+    close();
+    m_file.open(path.c_str(), ios::binary | ios::trunc);
+    if (!m_file)
+        return false;
+
+    const vector<TelemetryColumn>& columns = telemetryColumns();
+    uint32_t version = TELEMETRY_FILE_VERSION;
+    uint32_t numberOfColumns = (uint32_t) columns.size();
+    m_file.write("SWTL", 4);
+    m_file.write((const char*) &version, sizeof(version));
+    m_file.write((const char*) &numberOfColumns, sizeof(numberOfColumns));
+    for (size_t i = 0; i < columns.size(); i++) {
+        char type = (char) columns[i].type;
+        m_file.write(columns[i].name.c_str(), columns[i].name.size() + 1);
+        m_file.write(&type, 1);
+    }
+
+    m_written = 0;
+    m_dropped = 0;
+    m_running = true;
+    m_thread = thread(&TelemetryWriter::drain, this);
+    return true;
+}
+
+// Stop the thread once it has written everything in the ring, and close the file
+void TelemetryWriter::close() {
+    if (!m_thread.joinable())
+        return;
+    m_running = false;
+    m_thread.join();
+    m_file.close();
+}
+
+// Hand a record to the writer, or count it as dropped if the ring is full
+bool TelemetryWriter::record(const TelemetryRecord& record) {
+    if (m_ring.push(record))
+        return true;
+    m_dropped.fetch_add(1, memory_order_relaxed);
+    return false;
+}
+
+// Return the number of records written to the file so far
+long long TelemetryWriter::written() const {
+    return m_written.load(memory_order_relaxed);
+}
+
+// Return the number of records dropped because the ring was full
+long long TelemetryWriter::dropped() const {
+    return m_dropped.load(memory_order_relaxed);
+}
+
+// Background thread: move records from the ring into blocks and write each block once it is full
+// An empty ring is polled every millisecond, waking the thread up from the tick would cost the tick a system call
+void TelemetryWriter::drain() {
+    TelemetryRecord record;
+    while (true) {
+        bool stopping = !m_running.load(memory_order_acquire);
+        bool any = false;
+        while (m_ring.pop(record)) {
+            any = true;
+            m_block.push_back(record);
+            if ((int) m_block.size() == TELEMETRY_BLOCK_RECORDS)
+                writeBlock();
+        }
+        // Records pushed before close was called are in the ring by now
+        if (stopping)
+            break;
+        if (!any)
+            this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    writeBlock();
+    m_file.flush();
+}
+
+// Write the records collected so far as one block, column after column
+void TelemetryWriter::writeBlock() {
+    if (m_block.empty())
+        return;
+    uint32_t count = (uint32_t) m_block.size();
+    int64_t dropped = m_dropped.load(memory_order_relaxed);
+    m_file.write((const char*) &count, sizeof(count));
+    m_file.write((const char*) &dropped, sizeof(dropped));
+
+    const vector<TelemetryColumn>& columns = telemetryColumns();
+    vector<char> values(count * 4);
+    for (size_t c = 0; c < columns.size(); c++) {
+        for (uint32_t i = 0; i < count; i++)
+            memcpy(&values[i * 4], (const char*) &m_block[i] + columns[c].offset, 4);
+        m_file.write(values.data(), values.size());
+    }
+    m_written.fetch_add(count, memory_order_relaxed);
+    m_block.clear();
+}
+
+/*---------------------*/
+/*--------Reader-------*/
+/*---------------------*/
+
+// Convert a telemetry file to CSV, one row per record
+bool telemetryToCsv(istream& in, ostream& out, long long& dropped, string& error) {
+    char magic[4];
+    uint32_t version;
+    uint32_t numberOfColumns;
+    if (!in.read(magic, 4) || memcmp(magic, "SWTL", 4) != 0 || !in.read((char*) &version, sizeof(version)) || !in.read((char*) &numberOfColumns, sizeof(numberOfColumns))) {
+        error = "not a telemetry file";
+        return false;
+    }
+    if (version != TELEMETRY_FILE_VERSION) {
+        error = "unsupported telemetry version " + to_string(version);
+        return false;
+    }
+
+    // Columns are read from the header, so that files with other columns can still be converted
+    vector<int> types(numberOfColumns);
+    for (uint32_t c = 0; c < numberOfColumns; c++) {
+        string name;
+        char type;
+        if (!getline(in, name, '\0') || !in.read(&type, 1)) {
+            error = "truncated header";
+            return false;
+        }
+        types[c] = type;
+        out << (c > 0 ? "," : "") << name;
+    }
+    out << '\n';
+
+    dropped = 0;
+    uint32_t count;
+    while (in.read((char*) &count, sizeof(count))) {
+        int64_t droppedSoFar;
+        vector<char> values((size_t) count * 4 * numberOfColumns);
+        if (!in.read((char*) &droppedSoFar, sizeof(droppedSoFar)) || !in.read(values.data(), values.size())) {
+            error = "truncated block";
+            return false;
+        }
+        dropped = droppedSoFar;
+        for (uint32_t i = 0; i < count; i++) {
+            for (uint32_t c = 0; c < numberOfColumns; c++) {
+                const char* value = &values[((size_t) c * count + i) * 4];
+                if (c > 0)
+                    out << ',';
+                if (types[c] == TELEMETRY_FLOAT) {
+                    float number;
+                    memcpy(&number, value, 4);
+                    out << number;
+                }
+                else if (types[c] == TELEMETRY_UNSIGNED) {
+                    uint32_t number;
+                    memcpy(&number, value, 4);
+                    out << number;
+                }
+                else {
+                    int32_t number;
+                    memcpy(&number, value, 4);
+                    out << number;
+                }
+            }
+            out << '\n';
+        }
+    }
+    return true;
+}
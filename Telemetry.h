@@ -0,0 +1,98 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <cstddef>
+
+// Per tick telemetry for long running sessions
+// The thread that runs the ticks hands fixed size records to a single producer, single consumer ring without locking or
+// allocating. A background thread drains the ring into a binary columnar file. When the ring is full a record is dropped
+// and counted, the tick never waits for the disk
+
+const int TELEMETRY_OBJECT_TYPES = 13;      // One count per object type, ID_SOCRATES to ID_FUNGI
+
+// The metrics of one tick, every field is four bytes wide
+struct TelemetryRecord {
+    int tick;
+    int level;
+    int status;                             // What move returned
+    unsigned int score;
+    int lives;
+    int hitPoints;
+    int sprays;
+    int flames;
+    int projectiles;                        // Sprays and flames in flight
+    float tickMicroseconds;
+    int actors[TELEMETRY_OBJECT_TYPES];     // Active actors of each type at the end of the tick
+};
+
+// Lock-free ring for one producer thread and one consumer thread, the capacity is rounded up to a power of two
+class TelemetryRing {
+  public:
+    TelemetryRing(size_t capacity);
+    bool push(const TelemetryRecord& record);   // Producer only, false if the ring was full
+    bool pop(TelemetryRecord& record);          // Consumer only, false if the ring was empty
+    size_t capacity() const;
+  private:
+    std::vector<TelemetryRecord> m_slots;
+    size_t m_mask;
+    // Each index is written by one side only, and kept on its own cache line so that the sides do not contend
+    alignas(64) std::atomic<size_t> m_head;     // Next slot the producer writes
+    alignas(64) std::atomic<size_t> m_tail;     // Next slot the consumer reads
+};
+
+// Columnar telemetry file:
+//   header: "SWTL", uint32 version, uint32 number of columns, then per column its name ending in a zero byte and a type byte
+//   blocks: uint32 number of records, int64 records dropped so far, then each column's values back to back
+// Values are four bytes in the byte order of the machine that wrote them
+const int TELEMETRY_FILE_VERSION        = 1;
+const int TELEMETRY_INT                 = 0;
+const int TELEMETRY_UNSIGNED            = 1;
+const int TELEMETRY_FLOAT               = 2;
+const int TELEMETRY_BLOCK_RECORDS       = 1024;
+
+struct TelemetryColumn {
+    std::string name;
+    int type;
+    size_t offset;                          // Of the field in a TelemetryRecord
+};
+
+const std::vector<TelemetryColumn>& telemetryColumns();
+
+// Owns the ring and the background thread that writes it to a file
+class TelemetryWriter {
+  public:
+    TelemetryWriter(size_t capacity = 4096);
+    ~TelemetryWriter();
+    bool open(const std::string& path);
+    void close();                           // Drains what is left in the ring and finishes the file
+
+    // Called by the thread that runs the ticks, never blocks
+    bool record(const TelemetryRecord& record);
+
+    long long written() const;
+    long long dropped() const;
+  private:
+    TelemetryRing m_ring;
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    std::atomic<long long> m_written;
+    std::atomic<long long> m_dropped;
+    std::ofstream m_file;
+    std::vector<TelemetryRecord> m_block;
+
+    // Helper Functions
+    void drain();
+    void writeBlock();
+};
+
+// Convert a telemetry file to CSV with a header row, returns false if the file is not a telemetry file
+bool telemetryToCsv(std::istream& in, std::ostream& out, long long& dropped, std::string& error);
+
+#endif // TELEMETRY_H_
@@ -0,0 +1,40 @@
+// Converts a telemetry file written by TelemetryWriter to CSV
+// Build it on its own: g++ -std=c++17 TelemetryReader.cpp Telemetry.cpp -pthread -o TelemetryReader
+
+#include "Telemetry.h"
+#include <iostream>
+#include <fstream>
+using namespace std;
+
+// Usage: TelemetryReader FILE [CSV]
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        cerr << "Usage: " << argv[0] << " FILE [CSV]" << endl;
+        return 1;
+    }
+
+    ifstream in(argv[1], ios::binary);
+    if (!in) {
+        cerr << argv[1] << ": cannot open" << endl;
+        return 1;
+    }
+    ofstream file;
+    if (argc == 3) {
+        file.open(argv[2]);
+        if (!file) {
+            cerr << argv[2] << ": cannot open" << endl;
+            return 1;
+        }
+    }
+
+    long long dropped = 0;
+    string error;
+    bool converted = telemetryToCsv(in, (argc == 3) ? file : cout, dropped, error);
+    if (dropped > 0)
+        cerr << dropped << " records were dropped while recording" << endl;
+    if (!converted) {
+        cerr << argv[1] << ": " << error << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,311 @@
+#include "VectorEnvironment.h"
+#include "Actor.h"
+#include "OccupancyGrid.h"
+#include "GameConstants.h"
+#include <algorithm>
+using namespace std;
+
+/*---------------------*/
+/*-----ActionInput-----*/
+/*---------------------*/
+
+// Constructor
+ActionInput::ActionInput()
+    : m_action(ACTION_NONE)
+{}
+
+// Set the action of the coming tick
+void ActionInput::setAction(int action) {
+    m_action = action;
+}
+
+// Press the key of the action, once
+bool ActionInput::getKey(StudentWorld&, int& value) {
+    int action = m_action;
+    m_action = ACTION_NONE;
+    switch (action) {
+        case ACTION_LEFT:
+            value = KEY_PRESS_LEFT;
+            return true;
+        case ACTION_RIGHT:
+            value = KEY_PRESS_RIGHT;
+            return true;
+        case ACTION_SPRAY:
+            value = KEY_PRESS_SPACE;
+            return true;
+        case ACTION_FLAME:
+            value = KEY_PRESS_ENTER;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*---------------------*/
+/*--VectorEnvironment--*/
+/*---------------------*/
+
+// Constructor, starts a game in every world and the threads of the pool
+VectorEnvironment::VectorEnvironment(int numberOfWorlds, unsigned int seed, int threads, const WorldConfig& config, int maxEpisodeTicks)
+    : m_seed(seed), m_config(config), m_maxEpisodeTicks(maxEpisodeTicks), m_actions(nullptr), m_observations(nullptr), m_rewards(nullptr), m_dones(nullptr),
+      m_nextWorld(0), m_batch(0), m_busyWorkers(0), m_stopping(false)
+{
+    for (int i = 0; i < numberOfWorlds; i++) {
+        m_environments.emplace_back(new Environment());
+        m_environments[i]->gamesStarted = 0;
+        newGame(i);
+    }
+    if (threads <= 0)
+        threads = max(1, (int) thread::hardware_concurrency());
+    for (int t = 1; t < min(threads, max(numberOfWorlds, 1)); t++)
+        m_workers.emplace_back(&VectorEnvironment::workerLoop, this);
+}
+
+// Destructor, stops the pool before the worlds go
+VectorEnvironment::~VectorEnvironment() {
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (size_t t = 0; t < m_workers.size(); t++)
+        m_workers[t].join();
+}
+
+// Return the number of worlds
+int VectorEnvironment::size() const {
+    return (int) m_environments.size();
+}
+
+// Return the number of threads that step the worlds, counting the caller
+int VectorEnvironment::threads() const {
+    return (int) m_workers.size() + 1;
+}
+
+// Return one of the worlds
+StudentWorld& VectorEnvironment::world(int index) {
+    return *m_environments[index]->world;
+}
+
+// Start a new game at level 1, each game of each world from a seed of its own
+void VectorEnvironment::newGame(int index) {
+    Environment& environment = *m_environments[index];
+    environment.world.reset(new StudentWorld("", true));
+    environment.world->seedRandom(m_seed + index + (unsigned int) m_environments.size() * environment.gamesStarted++);
+    environment.world->setWorldConfig(m_config);
+    environment.world->setInputSource(&environment.input);
+    environment.world->init();
+    environment.lastScore = 0;
+    environment.episodeTicks = 0;
+}
+
+// Start a new game everywhere
+void VectorEnvironment::reset(float* observations) {
+    for (int i = 0; i < size(); i++) {
+        newGame(i);
+        observe(i, observations + i * OBSERVATION_SIZE);
+    }
+}
+
+// Step every world with its action, on every thread of the pool
+void VectorEnvironment::step(const int* actions, float* observations, float* rewards, unsigned char* dones) {
+    m_actions = actions;
+    m_observations = observations;
+    m_rewards = rewards;
+    m_dones = dones;
+    runBatch();
+}
+
+// Rasterize every world on the calling thread, a world takes a few microseconds
+void VectorEnvironment::rasterize(int resolution, bool falloff, float* grids) {
+    for (int i = 0; i < size(); i++)
+        rasterizeWorld(*m_environments[i]->world, resolution, falloff, grids + (size_t) i * occupancyGridSize(resolution));
+}
+
+// Play one tick of a world, then start its next episode if this one ended
+void VectorEnvironment::stepWorld(int index) {
+    Environment& environment = *m_environments[index];
+    StudentWorld& world = *environment.world;
+    environment.input.setAction(m_actions[index]);
+    int status = world.move();
+    environment.episodeTicks++;
+
+    float reward = (float) world.getScore() - (float) environment.lastScore;
+    if (status == GWSTATUS_PLAYER_DIED)
+        reward += REWARD_PLAYER_DIED;
+    environment.lastScore = world.getScore();
+    bool done = (status != GWSTATUS_CONTINUE_GAME || environment.episodeTicks >= m_maxEpisodeTicks);
+    m_rewards[index] = reward;
+    m_dones[index] = done ? 1 : 0;
+
+    if (done) {
+        world.cleanUp();
+        if (status == GWSTATUS_CONTINUE_GAME || world.isGameOver())
+            newGame(index);
+        else {
+            if (status == GWSTATUS_FINISHED_LEVEL)
+                world.advanceToNextLevel();
+            world.init();
+            environment.episodeTicks = 0;
+        }
+    }
+    observe(index, m_observations + index * OBSERVATION_SIZE);
+}
+
+// Write the observation of a world, finding the nearest bacteria and items in one pass over its records
+void VectorEnvironment::observe(int index, float* observation) {
+    StudentWorld& world = *m_environments[index]->world;
+    Socrates* player = world.player();
+    double radius = world.dishRadius();
+    double playerX = player->getX();
+    double playerY = player->getY();
+
+    // Nearest actors so far, kept sorted by distance in small fixed arrays
+    const int slots = OBSERVATION_BACTERIA + OBSERVATION_ITEMS;
+    double distance[slots];
+    const ActorRecord* nearest[slots];
+    int found[2] = { 0, 0 };
+    const int capacity[2] = { OBSERVATION_BACTERIA, OBSERVATION_ITEMS };
+    const int first[2] = { 0, OBSERVATION_BACTERIA };
+    int bacteria = 0;
+
+    const vector<ActorRecord>& records = world.records();
+    for (size_t i = 0; i < records.size(); i++) {
+        const ActorRecord& record = records[i];
+        if (!(record.flags & FLAG_ACTIVE))
+            continue;
+        int type = record.flags & FLAG_TYPE_MASK;
+        int group;
+        if (hasType(MASK_BACTERIA, type)) {
+            group = 0;
+            bacteria++;
+        }
+        else if (hasType(MASK_ITEMS, type))
+            group = 1;
+        else
+            continue;
+
+        double dx = record.x - playerX;
+        double dy = record.y - playerY;
+        double d = dx*dx + dy*dy;
+        int count = found[group];
+        if (count == capacity[group] && d >= distance[first[group] + count - 1])
+            continue;
+        int k = min(count, capacity[group] - 1);
+        while (k > 0 && distance[first[group] + k - 1] > d) {
+            distance[first[group] + k] = distance[first[group] + k - 1];
+            nearest[first[group] + k] = nearest[first[group] + k - 1];
+            k--;
+        }
+        distance[first[group] + k] = d;
+        nearest[first[group] + k] = &record;
+        found[group] = min(count + 1, capacity[group]);
+    }
+
+    observation[0] = (float) ((playerX - world.dishCenterX()) / radius);
+    observation[1] = (float) ((playerY - world.dishCenterY()) / radius);
+    observation[2] = player->hitPoints() / 100.0f;
+    observation[3] = player->sprays() / 20.0f;
+    observation[4] = player->ftCharges() / 5.0f;
+    observation[5] = (float) world.getLevel();
+    observation[6] = (float) bacteria;
+    observation[7] = (float) world.pits();
+    for (int group = 0; group < 2; group++) {
+        for (int k = 0; k < capacity[group]; k++) {
+            float* slot = observation + OBSERVATION_PLAYER + 3 * (first[group] + k);
+            if (k >= found[group]) {
+                slot[0] = slot[1] = slot[2] = 0;
+                continue;
+            }
+            const ActorRecord& record = *nearest[first[group] + k];
+            int type = record.flags & FLAG_TYPE_MASK;
+            slot[0] = (float) ((record.x - playerX) / radius);
+            slot[1] = (float) ((record.y - playerY) / radius);
+            if (group == 0)
+                slot[2] = (type == ID_REGULAR_SALMONELLA) ? 1 : (type == ID_AGGRESSIVE_SALMONELLA) ? 2 : 3;
+            else
+                slot[2] = (type == ID_HEALTH_GOODIE) ? 1 : (type == ID_FLAME_GOODIE) ? 2 : (type == ID_LIFE_GOODIE) ? 3 : 4;
+        }
+    }
+}
+
+// Wake the pool for one batch, step worlds on the calling thread too, and wait until every world is done
+void VectorEnvironment::runBatch() {
+    m_nextWorld = 0;
+    if (m_workers.empty()) {
+        stepWorlds();
+        return;
+    }
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_batch++;
+        m_busyWorkers = (int) m_workers.size();
+    }
+    m_wake.notify_all();
+    stepWorlds();
+    unique_lock<mutex> lock(m_mutex);
+    m_finished.wait(lock, [this]() { return m_busyWorkers == 0; });
+}
+
+// Take worlds of the current batch one at a time until there are none left
+void VectorEnvironment::stepWorlds() {
+    for (int i = m_nextWorld++; i < size(); i = m_nextWorld++)
+        stepWorld(i);
+}
+
+// Thread of the pool: step worlds whenever a new batch starts
+void VectorEnvironment::workerLoop() {
+    int batch = 0;
+    while (true) {
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_wake.wait(lock, [this, batch]() { return m_stopping || m_batch != batch; });
+            if (m_stopping)
+                return;
+            batch = m_batch;
+        }
+        stepWorlds();
+        lock_guard<mutex> lock(m_mutex);
+        if (--m_busyWorkers == 0)
+            m_finished.notify_one();
+    }
+}
+
+/*---------------------*/
+/*-----C interface-----*/
+/*---------------------*/
+
+// Create a vector environment with the original dish
+VectorEnvironment* vector_environment_create(int numberOfWorlds, unsigned int seed, int threads) {
+    return new VectorEnvironment(numberOfWorlds, seed, threads);
+}
+
+// Destroy a vector environment
+void vector_environment_destroy(VectorEnvironment* environment) {
+    delete environment;
+}
+
+// Return the number of floats in one observation
+int vector_environment_observation_size() {
+    return OBSERVATION_SIZE;
+}
+
+// Start a new game in every world
+void vector_environment_reset(VectorEnvironment* environment, float* observations) {
+    environment->reset(observations);
+}
+
+// Play one tick of every world
+void vector_environment_step(VectorEnvironment* environment, const int* actions, float* observations, float* rewards, unsigned char* dones) {
+    environment->step(actions, observations, rewards, dones);
+}
+
+// Return the number of floats in the occupancy grid of one world
+int vector_environment_grid_size(int resolution) {
+    return occupancyGridSize(resolution);
+}
+
+// Rasterize every world
+void vector_environment_rasterize(VectorEnvironment* environment, int resolution, int falloff, float* grids) {
+    environment->rasterize(resolution, falloff != 0, grids);
+}
@@ -0,0 +1,119 @@
+#ifndef VECTORENVIRONMENT_H_
+#define VECTORENVIRONMENT_H_
+
+#include "StudentWorld.h"
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Many headless worlds stepped together, for training automated players
+// Each call to step plays one tick of every world with one action each, spread over a pool of threads, and writes the
+// results straight into arrays the caller owns. A world whose episode ended is started over within the same call, so the
+// observation written for it is the first one of its next episode
+//
+// An episode is one attempt at one level. It ends when the player dies, the level is finished, or after maxEpisodeTicks.
+// The next episode plays the next level after a finished one, the same level after a death, and a new game from level 1
+// once the game is over or the episode ran out of ticks
+
+// Actions
+const int ACTION_NONE                   = 0;
+const int ACTION_LEFT                   = 1;
+const int ACTION_RIGHT                  = 2;
+const int ACTION_SPRAY                  = 3;
+const int ACTION_FLAME                  = 4;
+const int NUMBER_OF_ACTIONS             = 5;
+
+// Observation of one world, OBSERVATION_SIZE floats. Positions are relative to the player and divided by the dish radius
+//   [0, 8)     player: x and y from the center of the dish, hit points / 100, sprays / 20, flame charges / 5, level,
+//              bacteria alive, pits left
+//   [8, 32)    the 8 nearest bacteria, nearest first: dx, dy, kind (1 regular salmonella, 2 aggressive salmonella, 3 e. coli)
+//   [32, 44)   the 4 nearest goodies and fungi, nearest first: dx, dy, kind (1 health, 2 flame, 3 life, 4 fungus)
+// Slots without an actor are all zero
+const int OBSERVATION_PLAYER            = 8;
+const int OBSERVATION_BACTERIA          = 8;
+const int OBSERVATION_ITEMS             = 4;
+const int OBSERVATION_SIZE              = OBSERVATION_PLAYER + 3 * (OBSERVATION_BACTERIA + OBSERVATION_ITEMS);
+
+// The reward of a tick is the score it gained, and this on top when the player died
+const float REWARD_PLAYER_DIED          = -1000;
+
+// Hands the world the action of the current step as a key press
+class ActionInput : public InputSource {
+  public:
+    ActionInput();
+    void setAction(int action);
+    bool getKey(StudentWorld& world, int& value);
+  private:
+    int m_action;
+};
+
+class VectorEnvironment {
+  public:
+    // threads counts the calling thread, 0 for one per hardware thread
+    VectorEnvironment(int numberOfWorlds, unsigned int seed, int threads = 0, const WorldConfig& config = defaultWorldConfig(), int maxEpisodeTicks = 5000);
+    ~VectorEnvironment();
+    int size() const;
+    int threads() const;
+
+    // Start a new game in every world and write the first observations, numberOfWorlds * OBSERVATION_SIZE floats
+    void reset(float* observations);
+
+    // Play one tick of every world: actions holds one action per world, the other arrays receive one observation,
+    // reward and done flag per world
+    void step(const int* actions, float* observations, float* rewards, unsigned char* dones);
+
+    // Rasterize every world into its own occupancy grid, see rasterizeWorld, numberOfWorlds * occupancyGridSize floats
+    void rasterize(int resolution, bool falloff, float* grids);
+
+    StudentWorld& world(int index);
+  private:
+    struct Environment {
+        unique_ptr<StudentWorld> world;
+        ActionInput input;
+        unsigned int lastScore;
+        int episodeTicks;
+        int gamesStarted;
+    };
+    vector<unique_ptr<Environment>> m_environments;
+    unsigned int m_seed;
+    WorldConfig m_config;
+    int m_maxEpisodeTicks;
+
+    // The batch being stepped, and the pool that steps it
+    const int* m_actions;
+    float* m_observations;
+    float* m_rewards;
+    unsigned char* m_dones;
+    atomic<int> m_nextWorld;
+    vector<thread> m_workers;
+    mutex m_mutex;
+    condition_variable m_wake;
+    condition_variable m_finished;
+    int m_batch;
+    int m_busyWorkers;
+    bool m_stopping;
+
+    // Helper Functions
+    void newGame(int index);
+    void stepWorld(int index);
+    void observe(int index, float* observation);
+    void runBatch();
+    void stepWorlds();
+    void workerLoop();
+};
+
+// C interface for bindings from other languages, the arrays are laid out as in VectorEnvironment::step
+extern "C" {
+    VectorEnvironment* vector_environment_create(int numberOfWorlds, unsigned int seed, int threads);
+    void vector_environment_destroy(VectorEnvironment* environment);
+    int vector_environment_observation_size();
+    void vector_environment_reset(VectorEnvironment* environment, float* observations);
+    void vector_environment_step(VectorEnvironment* environment, const int* actions, float* observations, float* rewards, unsigned char* dones);
+    int vector_environment_grid_size(int resolution);
+    void vector_environment_rasterize(VectorEnvironment* environment, int resolution, int falloff, float* grids);
+}
+
+#endif // VECTORENVIRONMENT_H_
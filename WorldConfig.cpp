@@ -0,0 +1,185 @@
+#include "WorldConfig.h"
+#include "GameConstants.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+using namespace std;
+
+// Number of pits at the start of a level
+int WorldConfig::pits(int level) const {
+    return pitsPerLevel * level;
+}
+
+// Number of food objects at the start of a level
+int WorldConfig::food(int level) const {
+    return min(foodPerLevel * level, maxFood);
+}
+
+// Number of dirt piles at the start of a level
+int WorldConfig::dirt(int level) const {
+    return max(dirtBase - dirtPerLevel * level, minDirt);
+}
+
+// Upper end of the roll that adds a fungus when it comes up 0
+int WorldConfig::fungusChance(int level) const {
+    return max(fungusChanceBase - fungusChancePerLevel * level, minFungusChance);
+}
+
+// Upper end of the roll that adds a goodie when it comes up 0
+int WorldConfig::goodieChance(int level) const {
+    return max(goodieChanceBase - goodieChancePerLevel * level, minGoodieChance);
+}
+
+// The configuration of the original game
+WorldConfig defaultWorldConfig() {
+    WorldConfig config;
+    config.dishRadius = VIEW_RADIUS;
+    config.placementRadius = 120;
+    config.pitsPerLevel = 1;
+    config.foodPerLevel = 5;
+    config.maxFood = 25;
+    config.dirtBase = 180;
+    config.dirtPerLevel = 20;
+    config.minDirt = 20;
+    config.pitRegularSalmonella = 5;
+    config.pitAggressiveSalmonella = 3;
+    config.pitEColi = 2;
+    config.fungusChanceBase = 510;
+    config.fungusChancePerLevel = 10;
+    config.minFungusChance = 200;
+    config.goodieChanceBase = 510;
+    config.goodieChancePerLevel = 10;
+    config.minGoodieChance = 250;
+    config.lifeGoodieWeight = 1;
+    config.flameGoodieWeight = 3;
+    config.healthGoodieWeight = 6;
+    return config;
+}
+
+// Grow the dish to areaScale times its area, keeping the density of objects and of spawns per tick the same
+WorldConfig scaledWorldConfig(const WorldConfig& config, double areaScale) {
+    WorldConfig scaled = config;
+    double radiusScale = sqrt(areaScale);
+    // Keep the band between the placement circle and the rim as wide as it is, the player walks there
+    scaled.dishRadius = config.dishRadius * radiusScale;
+    scaled.placementRadius = scaled.dishRadius - (config.dishRadius - config.placementRadius);
+    auto times = [areaScale](int value) { return (int) lround(value * areaScale); };
+    scaled.pitsPerLevel = times(config.pitsPerLevel);
+    scaled.foodPerLevel = times(config.foodPerLevel);
+    scaled.maxFood = times(config.maxFood);
+    scaled.dirtBase = times(config.dirtBase);
+    scaled.dirtPerLevel = times(config.dirtPerLevel);
+    scaled.minDirt = times(config.minDirt);
+    // A roll of 0 to chance succeeds once in chance + 1 ticks
+    auto odds = [areaScale](int chance) { return max((int) lround((chance + 1) / areaScale) - 1, 0); };
+    scaled.fungusChanceBase = odds(config.fungusChanceBase);
+    scaled.fungusChancePerLevel = (int) lround(config.fungusChancePerLevel / areaScale);
+    scaled.minFungusChance = odds(config.minFungusChance);
+    scaled.goodieChanceBase = odds(config.goodieChanceBase);
+    scaled.goodieChancePerLevel = (int) lround(config.goodieChancePerLevel / areaScale);
+    scaled.minGoodieChance = odds(config.minGoodieChance);
+    return scaled;
+}
+
+// Read a configuration file over a configuration
+bool loadWorldConfig(const string& path, WorldConfig& config, string& error) {
+    ifstream in(path.c_str());
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    return parseWorldConfig(in, config, error);
+}
+
+// Read "key = value" lines over a configuration and check that the result makes sense
+bool parseWorldConfig(istream& in, WorldConfig& config, string& error) {
+    WorldConfig parsed = config;
+    struct Field {
+        const char* key;
+        int* integer;
+        double* real;
+    };
+    const Field fields[] = {
+        { "dish_radius", nullptr, &parsed.dishRadius },
+        { "placement_radius", nullptr, &parsed.placementRadius },
+        { "pits_per_level", &parsed.pitsPerLevel, nullptr },
+        { "food_per_level", &parsed.foodPerLevel, nullptr },
+        { "max_food", &parsed.maxFood, nullptr },
+        { "dirt_base", &parsed.dirtBase, nullptr },
+        { "dirt_per_level", &parsed.dirtPerLevel, nullptr },
+        { "min_dirt", &parsed.minDirt, nullptr },
+        { "pit_regular_salmonella", &parsed.pitRegularSalmonella, nullptr },
+        { "pit_aggressive_salmonella", &parsed.pitAggressiveSalmonella, nullptr },
+        { "pit_ecoli", &parsed.pitEColi, nullptr },
+        { "fungus_chance_base", &parsed.fungusChanceBase, nullptr },
+        { "fungus_chance_per_level", &parsed.fungusChancePerLevel, nullptr },
+        { "min_fungus_chance", &parsed.minFungusChance, nullptr },
+        { "goodie_chance_base", &parsed.goodieChanceBase, nullptr },
+        { "goodie_chance_per_level", &parsed.goodieChancePerLevel, nullptr },
+        { "min_goodie_chance", &parsed.minGoodieChance, nullptr },
+        { "life_goodie_weight", &parsed.lifeGoodieWeight, nullptr },
+        { "flame_goodie_weight", &parsed.flameGoodieWeight, nullptr },
+        { "health_goodie_weight", &parsed.healthGoodieWeight, nullptr },
+    };
+
+    string line;
+    int lineNumber = 0;
+    while (getline(in, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == string::npos)
+            continue;
+
+        size_t equals = line.find('=');
+        istringstream keyText(line.substr(0, equals));
+        string key;
+        keyText >> key;
+        const Field* field = nullptr;
+        for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+            if (key == fields[i].key)
+                field = &fields[i];
+        }
+        if (equals == string::npos || field == nullptr) {
+            error = "line " + to_string(lineNumber) + ": expected a known key = value";
+            return false;
+        }
+
+        string valueText = line.substr(equals + 1);
+        const char* start = valueText.c_str();
+        char* end = nullptr;
+        double value = strtod(start, &end);
+        if (end == start || valueText.find_first_not_of(" \t\r", end - start) != string::npos || (field->integer != nullptr && value != floor(value))) {
+            error = "line " + to_string(lineNumber) + ": bad value for " + key;
+            return false;
+        }
+        if (field->integer != nullptr)
+            *field->integer = (int) value;
+        else
+            *field->real = value;
+    }
+
+    // Everything must fit inside the dish and every count and chance must be usable as is
+    if (parsed.dishRadius < 2 * SPRITE_WIDTH || parsed.placementRadius <= 0 || parsed.placementRadius > parsed.dishRadius - SPRITE_RADIUS) {
+        error = "the placement radius must be positive and fit inside a dish at least 16 wide";
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        if (fields[i].integer != nullptr && *fields[i].integer < 0) {
+            error = string(fields[i].key) + " must not be negative";
+            return false;
+        }
+    }
+    // A pit keeps its bacteria in single bytes
+    if (parsed.pitRegularSalmonella > 255 || parsed.pitAggressiveSalmonella > 255 || parsed.pitEColi > 255) {
+        error = "a pit holds at most 255 bacteria of each type";
+        return false;
+    }
+    if (parsed.lifeGoodieWeight + parsed.flameGoodieWeight + parsed.healthGoodieWeight == 0) {
+        error = "at least one goodie weight must be positive";
+        return false;
+    }
+    config = parsed;
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef WORLDCONFIG_H_
+#define WORLDCONFIG_H_
+
+#include <string>
+#include <istream>
+
+// Geometry of the petri dish and the numbers that shape each level
+// The defaults are the original game. The dish is centered dishRadius away from the bottom and left edges of the
+// world, so a dish larger than the screen simply extends past it. Nothing in the simulation depends on the screen size
+
+struct WorldConfig {
+    double dishRadius;              // Bacteria may not leave this circle and the player walks its rim
+    double placementRadius;         // Pits, food and dirt are placed at most this far from the center
+
+    // A level L starts with pitsPerLevel*L pits, min(foodPerLevel*L, maxFood) food and max(dirtBase - dirtPerLevel*L, minDirt) dirt
+    int pitsPerLevel;
+    int foodPerLevel;
+    int maxFood;
+    int dirtBase;
+    int dirtPerLevel;
+    int minDirt;
+
+    // Bacteria released by every pit
+    int pitRegularSalmonella;
+    int pitAggressiveSalmonella;
+    int pitEColi;
+
+    // Every tick a fungus appears with odds 1 in max(fungusChanceBase - fungusChancePerLevel*L, minFungusChance) + 1,
+    // and a goodie likewise. Goodies are a life, flame or health goodie in proportion to their weights
+    int fungusChanceBase;
+    int fungusChancePerLevel;
+    int minFungusChance;
+    int goodieChanceBase;
+    int goodieChancePerLevel;
+    int minGoodieChance;
+    int lifeGoodieWeight;
+    int flameGoodieWeight;
+    int healthGoodieWeight;
+
+    int pits(int level) const;
+    int food(int level) const;
+    int dirt(int level) const;
+    int fungusChance(int level) const;
+    int goodieChance(int level) const;
+};
+
+WorldConfig defaultWorldConfig();
+
+// The same game on a dish areaScale times the area, with areaScale times the objects and spawns
+WorldConfig scaledWorldConfig(const WorldConfig& config, double areaScale);
+
+// Read "key = value" lines over a configuration, keys that are left out keep their value and # starts a comment
+// Returns false and describes the first bad line if the file cannot be read or does not make sense
+bool loadWorldConfig(const std::string& path, WorldConfig& config, std::string& error);
+bool parseWorldConfig(std::istream& in, WorldConfig& config, std::string& error);
+
+#endif // WORLDCONFIG_H_